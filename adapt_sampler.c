@@ -0,0 +1,37 @@
+/*
+ * adapt_sampler.c – Activity‑adaptive sampling rate (see adapt_sampler.h)
+ */
+
+#include <string.h>
+#include "adapt_sampler.h"
+
+void adapt_reset(adapt_sampler_t *a)
+{
+  memset(a, 0, sizeof(*a));
+}
+
+adapt_level_t adapt_update(adapt_sampler_t *a, int16_t motion)
+{
+  /* slide the window: drop the oldest reading once it is full */
+  if(a->n == ADAPT_WIN) {
+    int16_t old = a->win[a->idx];
+    a->sum   -= old;
+    a->sumsq -= (int32_t)old * old;
+  } else {
+    a->n++;
+  }
+  a->win[a->idx] = motion;
+  a->sum   += motion;
+  a->sumsq += (int32_t)motion * motion;
+  a->idx    = (a->idx + 1) % ADAPT_WIN;
+
+  if(a->n < 2) return ADAPT_BASE;
+
+  /* n²·var = n·Σx² − (Σx)², compared without dividing */
+  int32_t n2var = (int32_t)a->n * a->sumsq - a->sum * a->sum;
+  int32_t n2    = (int32_t)a->n * a->n;
+
+  if(n2var >= ADAPT_VAR_HIGH * n2) return ADAPT_FAST;
+  if(n2var <= ADAPT_VAR_LOW  * n2) return ADAPT_SLOW;
+  return ADAPT_BASE;
+}
@@ -0,0 +1,46 @@
+/*
+ * adapt_sampler.h – Activity‑adaptive sampling rate
+ *
+ * Tracks the variance of the last ADAPT_WIN motion readings (one pass,
+ * integer sums) and picks a sampling level:
+ *
+ *   variance ≥ ADAPT_VAR_HIGH  → ADAPT_FAST   (e.g. 10 Hz)
+ *   variance ≤ ADAPT_VAR_LOW   → ADAPT_SLOW   (e.g. 0.5 Hz)
+ *   otherwise                  → ADAPT_BASE   (1 Hz)
+ *
+ * The caller maps levels to intervals; variance is in centi‑g².
+ */
+
+#ifndef ADAPT_SAMPLER_H_
+#define ADAPT_SAMPLER_H_
+
+#include <stdint.h>
+
+#define ADAPT_WIN          8          /* readings in the variance window */
+
+#ifdef ADAPT_CONF_VAR_HIGH
+#define ADAPT_VAR_HIGH     ADAPT_CONF_VAR_HIGH
+#else
+#define ADAPT_VAR_HIGH     25         /* σ ≥ 5 centi‑g  */
+#endif
+
+#ifdef ADAPT_CONF_VAR_LOW
+#define ADAPT_VAR_LOW      ADAPT_CONF_VAR_LOW
+#else
+#define ADAPT_VAR_LOW      1          /* σ ≤ 1 centi‑g  */
+#endif
+
+typedef enum { ADAPT_SLOW = 0, ADAPT_BASE, ADAPT_FAST } adapt_level_t;
+
+typedef struct {
+  int16_t win[ADAPT_WIN];
+  int32_t sum;
+  int32_t sumsq;
+  uint8_t idx;
+  uint8_t n;
+} adapt_sampler_t;
+
+void          adapt_reset(adapt_sampler_t *a);
+adapt_level_t adapt_update(adapt_sampler_t *a, int16_t motion);
+
+#endif /* ADAPT_SAMPLER_H_ */
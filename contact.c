@@ -0,0 +1,50 @@
+/*
+ * contact.c – Per‑time‑of‑day reachability model (see contact.h)
+ */
+
+#include <string.h>
+#include "contact.h"
+
+static uint8_t bin(unsigned long t)
+{
+  return (uint8_t)((t / CONTACT_BIN_S) % CONTACT_BINS);
+}
+
+static uint8_t worth(const contact_t *c, uint8_t b, uint8_t min)
+{
+  return c->n[b] < CONTACT_LEARN || c->p[b] >= min;
+}
+
+void contact_init(contact_t *c)
+{
+  memset(c->p, 128, sizeof(c->p));
+  memset(c->n, 0, sizeof(c->n));
+}
+
+void contact_update(contact_t *c, unsigned long now, uint8_t ok)
+{
+  uint8_t b = bin(now);
+  int16_t p = c->p[b];
+
+  p += ((ok ? 255 : 0) - p) / CONTACT_GAIN;
+  c->p[b] = (uint8_t)p;
+  if(c->n[b] < UINT8_MAX) c->n[b]++;
+}
+
+uint8_t contact_p(const contact_t *c, unsigned long t)
+{
+  return c->p[bin(t)];
+}
+
+unsigned long contact_wait(const contact_t *c, unsigned long now,
+                           uint8_t min, unsigned long horizon)
+{
+  unsigned long t = now;
+
+  /* a day's slices at most, each from its start */
+  for(uint8_t k = 0; k <= CONTACT_BINS && t - now <= horizon; k++) {
+    if(worth(c, bin(t), min)) return t - now;
+    t = (t / CONTACT_BIN_S + 1) * CONTACT_BIN_S;
+  }
+  return CONTACT_NEVER;
+}
@@ -0,0 +1,55 @@
+/*
+ * contact.h – Per‑time‑of‑day model of when the peer is reachable
+ *
+ * A tag that moves in and out of Node B's range on a daily routine
+ * wastes most of its requests at the times it is away.  The model keeps
+ * one success probability per CONTACT_BINS slice of the day, an EWMA of
+ * contact attempts that found the peer (1) or gave up without it (0),
+ * and answers how long to wait for a slice worth trying.
+ *
+ *   contact_update()   record an attempt's outcome at time now
+ *   contact_p()        probability for time t, /255
+ *   contact_wait()     s from now to the first slice worth trying, 0 if
+ *                      the current one is; CONTACT_NEVER if none within
+ *                      horizon s
+ *
+ * A slice with fewer than CONTACT_LEARN outcomes is always worth
+ * trying, so the model explores it first.  Times are clock_seconds();
+ * without a wall clock "time of day" is taken modulo CONTACT_DAY from
+ * boot, which is enough for a routine with a 24 h period.  The model
+ * lives in RAM and is learned again after a reset.
+ */
+
+#ifndef CONTACT_H_
+#define CONTACT_H_
+
+#include <stdint.h>
+
+#ifdef CONTACT_CONF_BINS
+#define CONTACT_BINS         CONTACT_CONF_BINS
+#else
+#define CONTACT_BINS         48    /* 30 min slices */
+#endif
+#define CONTACT_DAY          86400UL
+#define CONTACT_BIN_S        (CONTACT_DAY / CONTACT_BINS)
+#define CONTACT_LEARN        3     /* outcomes before a slice is judged */
+#define CONTACT_GAIN         4     /* EWMA weight 1/4 */
+#define CONTACT_NEVER        0xFFFFFFFFUL
+
+#if CONTACT_DAY % CONTACT_BINS
+#error "CONTACT_BINS must divide a day into whole seconds"
+#endif
+
+typedef struct {
+  uint8_t p[CONTACT_BINS];         /* success probability, /255 */
+  uint8_t n[CONTACT_BINS];         /* outcomes seen, saturating */
+} contact_t;
+
+void          contact_init(contact_t *c);
+void          contact_update(contact_t *c, unsigned long now, uint8_t ok);
+uint8_t       contact_p(const contact_t *c, unsigned long t);
+/* min: probability /255 a slice needs to be worth trying */
+unsigned long contact_wait(const contact_t *c, unsigned long now,
+                           uint8_t min, unsigned long horizon);
+
+#endif /* CONTACT_H_ */
@@ -0,0 +1,148 @@
+/*
+ * evlog.c – Deferred binary event log (see evlog.h)
+ *
+ * – evlog_put() only copies id + args into a fixed RAM ring with
+ *   interrupts masked, so it is safe from rtimer and radio callbacks.
+ * – When the ring is full new events are counted and dropped; the count
+ *   is reported as EV_LOG_DROPPED on the next flush.
+ * – evlog_process wakes every EVLOG_FLUSH_INTERVAL (or early when the
+ *   ring is half full) and prints EVLOG_BATCH events per turn, yielding
+ *   in between so it never starves the protocol processes.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include "contiki.h"
+#include "sys/int-master.h"
+#include "evlog.h"
+
+/* ------------ parameters ------------ */
+#ifdef EVLOG_CONF_FLUSH_INTERVAL
+#define EVLOG_FLUSH_INTERVAL   EVLOG_CONF_FLUSH_INTERVAL
+#else
+#define EVLOG_FLUSH_INTERVAL   (CLOCK_SECOND / 2)
+#endif
+
+#define EVLOG_BATCH            4            /* events printed per turn */
+
+#if (EVLOG_SIZE & (EVLOG_SIZE - 1)) != 0 || EVLOG_SIZE > 128
+#error "EVLOG_SIZE must be a power of two no larger than 128"
+#endif
+
+/* ------------ format table ------------ */
+#define EVLOG_EVENT(id, fmt) fmt,
+static const char *const evlog_fmt[EV_COUNT] = {
+#include "evlog_events.h"
+};
+#undef EVLOG_EVENT
+
+/* ------------ ring ------------ */
+typedef struct {
+  uint8_t id;
+  long    arg[EVLOG_ARGS];
+} evlog_entry_t;
+
+static evlog_entry_t ring[EVLOG_SIZE];
+static volatile uint8_t ring_head = 0;    /* next to print (consumer) */
+static volatile uint8_t ring_tail = 0;    /* next free    (producers) */
+static volatile uint16_t dropped  = 0;
+
+#define RING_USED()  ((uint8_t)(ring_tail - ring_head))
+
+PROCESS(evlog_process, "evlog flush");
+
+/* ------------ producer ------------ */
+void evlog_put(uint8_t id, long a0, long a1, long a2, long a3)
+{
+  int_master_status_t s = int_master_read_and_disable();
+
+  if(RING_USED() >= EVLOG_SIZE) {
+    dropped++;
+    int_master_status_set(s);
+    return;
+  }
+
+  evlog_entry_t *e = &ring[ring_tail & (EVLOG_SIZE - 1)];
+  e->id     = id;
+  e->arg[0] = a0;
+  e->arg[1] = a1;
+  e->arg[2] = a2;
+  e->arg[3] = a3;
+  ring_tail++;
+
+  uint8_t used = RING_USED();
+  int_master_status_set(s);
+
+  if(used == EVLOG_SIZE / 2) {
+    process_poll(&evlog_process);     /* flush early, before we drop */
+  }
+}
+
+/* ------------ consumer ------------ */
+static uint8_t flush_one(void)
+{
+  if(RING_USED() == 0) return 0;
+
+  /* copy out first so the slot can be reused while we print */
+  evlog_entry_t e = ring[ring_head & (EVLOG_SIZE - 1)];
+  ring_head++;
+
+  if(e.id < EV_COUNT) {
+    printf(evlog_fmt[e.id], e.arg[0], e.arg[1], e.arg[2], e.arg[3]);
+  }
+  return 1;
+}
+
+static void report_dropped(void)
+{
+  int_master_status_t s = int_master_read_and_disable();
+  uint16_t n = dropped;
+  dropped = 0;
+  int_master_status_set(s);
+
+  if(n) printf(evlog_fmt[EV_LOG_DROPPED], (unsigned long)n);
+}
+
+void evlog_flush(void)
+{
+  while(flush_one());
+  report_dropped();
+}
+
+void evlog_kick(void)
+{
+  process_poll(&evlog_process);
+}
+
+void evlog_init(void)
+{
+  if(!process_is_running(&evlog_process)) {
+    process_start(&evlog_process, NULL);
+  }
+}
+
+/* ------------ Contiki process ------------ */
+PROCESS_THREAD(evlog_process, ev, data)
+{
+  static struct etimer flush_timer;
+  static uint8_t n;
+
+  PROCESS_BEGIN();
+
+  etimer_set(&flush_timer, EVLOG_FLUSH_INTERVAL);
+
+  while(1) {
+    PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_POLL ||
+                             etimer_expired(&flush_timer));
+
+    do {
+      for(n = 0; n < EVLOG_BATCH && flush_one(); n++);
+      if(n == EVLOG_BATCH) PROCESS_PAUSE();   /* let others run */
+    } while(n == EVLOG_BATCH);
+    report_dropped();
+
+    if(etimer_expired(&flush_timer)) etimer_reset(&flush_timer);
+  }
+
+  PROCESS_END();
+}
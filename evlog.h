@@ -0,0 +1,92 @@
+/*
+ * evlog.h – Deferred binary event log
+ *
+ * printf() from rtimer / radio callbacks stretches radio‑on windows and
+ * jitters slot timing.  Hot paths instead record a compact event (id + up
+ * to four integer args) into a RAM ring; evlog_process formats and
+ * flushes the ring to the console when the node is otherwise idle.
+ *
+ * Usage
+ * ----------
+ *   EVLOG_INFO(EV_UPLOAD_DONE, clock_seconds(), buf_len);
+ *
+ * Event ids and their format strings live in evlog_events.h.  Every
+ * argument is widened to long, so formats use %ld / %lu.
+ *
+ * Levels below EVLOG_LEVEL compile to nothing (arguments are not
+ * evaluated).  Override with EVLOG_CONF_LEVEL, e.g.
+ *   CFLAGS += -DEVLOG_CONF_LEVEL=EVLOG_LEVEL_WARN
+ */
+
+#ifndef EVLOG_H_
+#define EVLOG_H_
+
+#include <stdint.h>
+
+/* ------------ levels ------------ */
+#define EVLOG_LEVEL_NONE   0
+#define EVLOG_LEVEL_ERR    1
+#define EVLOG_LEVEL_WARN   2
+#define EVLOG_LEVEL_INFO   3
+#define EVLOG_LEVEL_DBG    4
+
+#ifdef EVLOG_CONF_LEVEL
+#define EVLOG_LEVEL        EVLOG_CONF_LEVEL
+#else
+#define EVLOG_LEVEL        EVLOG_LEVEL_INFO
+#endif
+
+/* ring capacity in events – must be a power of two */
+#ifdef EVLOG_CONF_SIZE
+#define EVLOG_SIZE         EVLOG_CONF_SIZE
+#else
+#define EVLOG_SIZE         32
+#endif
+
+/* ------------ event ids ------------ */
+#define EVLOG_EVENT(id, fmt) id,
+typedef enum {
+#include "evlog_events.h"
+  EV_COUNT
+} evlog_id_t;
+#undef EVLOG_EVENT
+
+/* ------------ API ------------ */
+void evlog_init(void);                  /* start the flush process    */
+void evlog_put(uint8_t id, long a0, long a1, long a2, long a3); /* ISR‑safe */
+void evlog_flush(void);                 /* drain ring now (process ctx) */
+void evlog_kick(void);                  /* flush on the next scheduler turn */
+
+#define EVLOG_ARGS         4
+
+/* pad missing args with 0 so every call site is evlog_put(id, a, b, c, d) */
+#define EVLOG_EMIT_(id, a0, a1, a2, a3, ...) \
+  evlog_put((id), (long)(a0), (long)(a1), (long)(a2), (long)(a3))
+#define EVLOG_EMIT(...)  EVLOG_EMIT_(__VA_ARGS__, 0, 0, 0, 0)
+#define EVLOG_NOP(...)   do { } while(0)
+
+#if EVLOG_LEVEL >= EVLOG_LEVEL_ERR
+#define EVLOG_ERR(...)   EVLOG_EMIT(__VA_ARGS__)
+#else
+#define EVLOG_ERR(...)   EVLOG_NOP(__VA_ARGS__)
+#endif
+
+#if EVLOG_LEVEL >= EVLOG_LEVEL_WARN
+#define EVLOG_WARN(...)  EVLOG_EMIT(__VA_ARGS__)
+#else
+#define EVLOG_WARN(...)  EVLOG_NOP(__VA_ARGS__)
+#endif
+
+#if EVLOG_LEVEL >= EVLOG_LEVEL_INFO
+#define EVLOG_INFO(...)  EVLOG_EMIT(__VA_ARGS__)
+#else
+#define EVLOG_INFO(...)  EVLOG_NOP(__VA_ARGS__)
+#endif
+
+#if EVLOG_LEVEL >= EVLOG_LEVEL_DBG
+#define EVLOG_DBG(...)   EVLOG_EMIT(__VA_ARGS__)
+#else
+#define EVLOG_DBG(...)   EVLOG_NOP(__VA_ARGS__)
+#endif
+
+#endif /* EVLOG_H_ */
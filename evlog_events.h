@@ -0,0 +1,82 @@
+/*
+ * evlog_events.h – Event ids and format strings for evlog
+ *
+ * X‑macro list, included by evlog.h (ids) and evlog.c (formats).
+ * All args are long: use %ld / %lu / %lX.  Keep the ids grouped per
+ * firmware; appending is always safe, ids are never sent over the air.
+ */
+
+/* ---- evlog itself ---- */
+EVLOG_EVENT(EV_LOG_DROPPED,        "evlog: %lu events dropped\n")
+
+/* ---- nbr.c ---- */
+EVLOG_EVENT(EV_NBR_START,          "Start clock %lu ticks, timestamp %3lu.%03lu\n")
+EVLOG_EVENT(EV_NBR_RX,             "RX seq %lu from %lu phase %lu flags 0x%02lX\n")
+EVLOG_EVENT(EV_NBR_TO_AGGRESSIVE,  "MODE_NORMAL -> MODE_AGGRESSIVE\n")
+EVLOG_EVENT(EV_NBR_ACK_SEEN,       "ACK seen -> MODE_COMPLETE\n")
+EVLOG_EVENT(EV_NBR_ACK_WINDOW,     "Start ACK window\n")
+EVLOG_EVENT(EV_NBR_PEER_ACK,       "Peer ACK -> MODE_COMPLETE\n")
+EVLOG_EVENT(EV_NBR_COMPLETE,       "Discovery complete (%lu missed slots), stopping transmissions and entering sleep mode.\n")
+EVLOG_EVENT(EV_NBR_SEND,           "Send seq# %lu  @ %8lu ticks, phase %lu\n")
+EVLOG_EVENT(EV_NBR_AGGR_TIMEOUT,   "10s aggressive mode timeout -> MODE_NORMAL\n")
+EVLOG_EVENT(EV_NBR_ACK_DONE,       "ACK window done -> MODE_COMPLETE\n")
+EVLOG_EVENT(EV_NBR_SLEEP,          "Sleep for %ld slots (mode %ld)\n")
+
+/* ---- node_a_v2.c ---- */
+EVLOG_EVENT(EV_A_REQ_TX,           "TX REQUEST (good=%lu)\n")
+EVLOG_EVENT(EV_A_MOTION,           "%lu Motion detected - start collecting\n")
+EVLOG_EVENT(EV_A_SET_DONE,         "%lu Set collected - buffer=%lu\n")
+EVLOG_EVENT(EV_A_SET_DROP,         "Queue full - set %lu (activity %lu) dropped, %lu so far\n")
+EVLOG_EVENT(EV_A_UPLOAD_DONE,      "%lu Upload complete – buffer=%lu missed slots=%lu\n")
+EVLOG_EVENT(EV_A_STREAM_WAIT,      "Slice %lu not collected yet - waiting\n")
+EVLOG_EVENT(EV_A_ALERT,            "%lu ALERT motion=%ld - preempting upload\n")
+EVLOG_EVENT(EV_A_ALERT_ACKED,      "Alert %lu acked after %lu tries\n")
+EVLOG_EVENT(EV_A_ALERT_LOST,       "Alert %lu not acked - retry budget used up\n")
+EVLOG_EVENT(EV_A_BUDGET_OUT,       "%lu Request budget spent - silent until the hour rolls over\n")
+EVLOG_EVENT(EV_A_RI_LISTEN,        "RI listen for beacon\n")
+EVLOG_EVENT(EV_A_RI_BEACON,        "Beacon rssi=%ld - sending\n")
+EVLOG_EVENT(EV_A_BLOCK_ACK,        "RX BLOCK_ACK map=0x%03lX heard %lu/%lu\n")
+EVLOG_EVENT(EV_A_PARITY_TX,        "TX PARITY group 0x%02lX over %lu-sample runs, loss=%lu/256\n")
+EVLOG_EVENT(EV_A_RUN_SIZE,        "Frame size %lu samples (loss=%lu/256)\n")
+EVLOG_EVENT(EV_A_LAT_REQ,          "REQ_ACK latency: n=%lu avg=%lu us max=%lu us timeouts=%lu\n")
+EVLOG_EVENT(EV_A_LAT_DATA,         "DATA ACK latency: n=%lu avg=%lu us max=%lu us timeouts=%lu\n")
+EVLOG_EVENT(EV_A_SLOT,             "Slot %lu in %lu ms, every %lu ms\n")
+EVLOG_EVENT(EV_A_SLOT_LOST,        "No block ACK in slot %lu - giving it up\n")
+EVLOG_EVENT(EV_A_COST,             "Radio %lu us (%lu uJ) per delivered sample, %lu handshakes for %lu sets\n")
+EVLOG_EVENT(EV_A_DELAY,            "Sets waited avg %lu s max %lu s from completion to delivery (batch %lu)\n")
+EVLOG_EVENT(EV_A_CONTACT,          "Contact hit=%lu in slice %lu, p=%lu/255\n")
+EVLOG_EVENT(EV_A_CONTACT_HOLD,     "Contact p=%lu/255 now - holding %lu s with %lu sets\n")
+EVLOG_EVENT(EV_A_DISC_TX,          "TX discovery beacon %lu (%lu more this round)\n")
+EVLOG_EVENT(EV_A_DISC,             "Peer %lu found rssi=%ld here %ld there - set in %lu ms\n")
+EVLOG_EVENT(EV_A_DISC_WEAK,        "Peer answer too weak rssi=%ld here %ld there\n")
+EVLOG_EVENT(EV_A_SLOT_STALE,       "Slot %lu more than %lu periods behind - giving it up\n")
+
+/* ---- node_b_v2.c ---- */
+EVLOG_EVENT(EV_B_REQ_ACK,          "TX REQ_ACK (motionless)\n")
+EVLOG_EVENT(EV_B_REQ_MOVING,       "Ignore REQ – moving\n")
+EVLOG_EVENT(EV_B_RX_DATA,          "RX RUN samples %lu+%lu\n")
+EVLOG_EVENT(EV_B_DATA_ACK,         "TX DATA_ACK %lu\n")
+EVLOG_EVENT(EV_B_BLOCK_ACK,        "TX BLOCK_ACK map=0x%03lX heard=%lu\n")
+EVLOG_EVENT(EV_B_FEC_RECOVER,      "Samples %lu+%lu rebuilt from parity\n")
+EVLOG_EVENT(EV_B_SET_DONE,         "Full set received - %lu samples stored, span %lu ms\n")
+EVLOG_EVENT(EV_B_SUMMARY,          "Set summary from %lu - %lu samples, span %lu ms, motion peaks %lu\n")
+EVLOG_EVENT(EV_B_SUM_LIGHT,        "  light  mean %ld var %lu range %ld..%ld\n")
+EVLOG_EVENT(EV_B_SUM_MOTION,       "  motion mean %ld var %lu range %ld..%ld\n")
+EVLOG_EVENT(EV_B_ALERT,            "%lu ALERT from %lu: motion %ld centi-g (alert %lu)\n")
+EVLOG_EVENT(EV_B_RELAY_ACK,        "TX relay ACK batch %lu map=0x%04lX\n")
+EVLOG_EVENT(EV_B_RELAY_QUEUED,     "Relay set queued: tag %lu via %lu set %lu\n")
+EVLOG_EVENT(EV_B_RELAY_SET,        "Relayed set %lu from %lu via %lu received - span %lu ms\n")
+EVLOG_EVENT(EV_B_RELAY_SENT,       "Relay batch %lu: %lu sets forwarded in %lu rounds (%lu dropped so far)\n")
+EVLOG_EVENT(EV_B_RELAY_FAIL,       "Relay batch %lu not acked (map=0x%04lX of %lu frames) - backing off\n")
+EVLOG_EVENT(EV_B_RELAY_FULL,       "Relay queue busy - set from %lu not queued\n")
+EVLOG_EVENT(EV_B_OUT_BUSY,         "Set %lu/%lu not logged - output queue full\n")
+EVLOG_EVENT(EV_B_LOG_MOUNT,        "Set log mounted - next seq %lu, boot %lu\n")
+EVLOG_EVENT(EV_B_LOG_FAIL,         "Set log unavailable - flash not answering\n")
+EVLOG_EVENT(EV_B_LOG_LOST,         "Set %lu/%lu not logged - flash write failed\n")
+EVLOG_EVENT(EV_B_LOG_DUMP,         "Set log dump from seq %lu\n")
+EVLOG_EVENT(EV_B_LOG_DONE,         "Set log dump done - %lu sets\n")
+EVLOG_EVENT(EV_B_QUERY,            "Query kind %lu from %lu - %lu entries from %lu sent\n")
+EVLOG_EVENT(EV_B_SLOT_ACK,         "TX REQ_ACK slot %lu to %lu\n")
+EVLOG_EVENT(EV_B_SLOT_FULL,        "No free slot for %lu - plain REQ_ACK\n")
+EVLOG_EVENT(EV_B_SET_DROP,         "Partial set from %lu dropped - run from %lu\n")
+EVLOG_EVENT(EV_B_DISC,             "Discovery beacon from %lu rssi=%ld flags 0x%02lX - set in %lu ms\n")
@@ -0,0 +1,60 @@
+/*
+ * feature.c – One‑pass per‑window statistics (see feature.h)
+ */
+
+#include <string.h>
+#include "feature.h"
+
+void feat_reset(feat_acc_t *f, int16_t peak_delta,
+                int16_t hist_lo, uint8_t hist_shift)
+{
+  memset(f, 0, sizeof(*f));
+  f->peak_delta = peak_delta;
+  f->hist_lo    = hist_lo;
+  f->hist_shift = hist_shift;
+  f->min        = INT16_MAX;
+  f->max        = INT16_MIN;
+}
+
+void feat_add(feat_acc_t *f, int16_t x)
+{
+  f->sum   += x;
+  f->sumsq += (int32_t)x * x;
+  if(x < f->min) f->min = x;
+  if(x > f->max) f->max = x;
+
+  /* prev is a peak if it stands out from both of its neighbours */
+  if(f->n >= 2 &&
+     f->prev - f->prev2 >= f->peak_delta &&
+     f->prev - x        >= f->peak_delta &&
+     f->peaks < UINT8_MAX) {
+    f->peaks++;
+  }
+  f->prev2 = f->prev;
+  f->prev  = x;
+
+  int32_t bin = ((int32_t)x - f->hist_lo) >> f->hist_shift;
+  if(bin < 0) bin = 0;
+  if(bin >= FEAT_HIST_BINS) bin = FEAT_HIST_BINS - 1;
+  if(f->hist[bin] < UINT8_MAX) f->hist[bin]++;
+
+  f->n++;
+}
+
+void feat_finish(const feat_acc_t *f, feat_summary_t *out)
+{
+  memset(out, 0, sizeof(*out));
+  if(f->n == 0) return;
+
+  int32_t mean = f->sum / f->n;
+  /* n²·var = n·Σx² − (Σx)² */
+  int64_t n2var = (int64_t)f->n * f->sumsq - (int64_t)f->sum * f->sum;
+  int64_t var   = n2var / ((int64_t)f->n * f->n);
+
+  out->mean  = (int16_t)mean;
+  out->var   = var > UINT32_MAX ? UINT32_MAX : (uint32_t)var;
+  out->min   = f->min;
+  out->max   = f->max;
+  out->peaks = f->peaks;
+  memcpy(out->hist, f->hist, sizeof(out->hist));
+}
@@ -0,0 +1,50 @@
+/*
+ * feature.h – One‑pass per‑window statistics for on‑node summaries
+ *
+ * feat_add() is O(1) and integer only, so it can run on every sample in
+ * ST_COLLECTING; feat_finish() turns the running sums into a compact
+ * feat_summary_t (mean, variance, min, max, peak count, histogram).
+ *
+ * A peak is a local maximum that rises at least peak_delta above both
+ * neighbours.  The histogram has FEAT_HIST_BINS bins of width
+ * 2^hist_shift starting at hist_lo; values outside are clamped into the
+ * first / last bin.
+ */
+
+#ifndef FEATURE_H_
+#define FEATURE_H_
+
+#include <stdint.h>
+
+#define FEAT_HIST_BINS     8
+
+typedef struct {
+  /* parameters */
+  int16_t  peak_delta;
+  int16_t  hist_lo;
+  uint8_t  hist_shift;
+  /* running state */
+  uint16_t n;
+  int32_t  sum;
+  int64_t  sumsq;
+  int16_t  min, max;
+  int16_t  prev, prev2;
+  uint8_t  peaks;
+  uint8_t  hist[FEAT_HIST_BINS];
+} feat_acc_t;
+
+typedef struct __attribute__((packed)) {
+  int16_t  mean;
+  uint32_t var;            /* population variance, saturated */
+  int16_t  min;
+  int16_t  max;
+  uint8_t  peaks;
+  uint8_t  hist[FEAT_HIST_BINS];
+} feat_summary_t;          /* 19 bytes, sent as is in PKT_SUMMARY */
+
+void feat_reset(feat_acc_t *f, int16_t peak_delta,
+                int16_t hist_lo, uint8_t hist_shift);
+void feat_add(feat_acc_t *f, int16_t x);
+void feat_finish(const feat_acc_t *f, feat_summary_t *out);
+
+#endif /* FEATURE_H_ */
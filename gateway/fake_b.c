@@ -0,0 +1,98 @@
+/*
+ * fake_b.c – Stand‑in Node B on a pty, for exercising gw without hardware
+ *
+ * usage: fake_b [-t tags] [-r sets_per_s] [-n sets] [-e bad_percent]
+ *
+ * Opens a pseudo terminal, prints the slave's path on stdout and then
+ * writes node_b_v2.c style output to it: a $SET line per set, cycling
+ * through tags Node As (ids 1 … tags), mixed with ordinary log lines.
+ * -e corrupts that share of the $SET lines (checksum or truncation),
+ * which gw must count as bad and skip.  Exits after -n sets (0: never).
+ *
+ *   ./fake_b -t 50 -r 200 &        # prints e.g. /dev/pts/7
+ *   ./gw -d store /dev/pts/7
+ */
+
+#define _XOPEN_SOURCE 700
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define SAMPLES   60
+
+static char line[1024];
+
+static size_t build_set(unsigned origin, unsigned set_no)
+{
+  size_t  len;
+  uint8_t cs = 0;
+
+  len = snprintf(line, sizeof(line), "$SET,%u,512,%u,%u,", origin, set_no,
+                 SAMPLES);
+  for(int i = 0; i < SAMPLES; i++) {
+    int light  = 200 + (int)(origin * 7 + set_no + i) % 300;
+    int motion = (i % 20 == 0) ? -150 : (int)(rand() % 40) - 20;
+    len += snprintf(line + len, sizeof(line) - len, "%04X%04X%02X",
+                    (unsigned)(uint16_t)light, (unsigned)(uint16_t)motion,
+                    i ? 10 : 0);
+  }
+  for(size_t i = 1; i < len; i++) cs ^= (uint8_t)line[i];
+  len += snprintf(line + len, sizeof(line) - len, "*%02X\n", cs);
+  return len;
+}
+
+int main(int argc, char **argv)
+{
+  unsigned tags = 1, rate = 10, total = 0, bad = 0, sent = 0;
+  int      master, opt;
+  uint8_t  set_no[65536] = { 0 };
+
+  while((opt = getopt(argc, argv, "t:r:n:e:")) != -1) {
+    switch(opt) {
+    case 't': tags  = atoi(optarg); break;
+    case 'r': rate  = atoi(optarg); break;
+    case 'n': total = atoi(optarg); break;
+    case 'e': bad   = atoi(optarg); break;
+    default:
+      fprintf(stderr, "usage: fake_b [-t tags] [-r sets_per_s] [-n sets] "
+              "[-e bad_percent]\n");
+      return 2;
+    }
+  }
+  if(tags == 0 || tags > 65535 || rate == 0) return 2;
+
+  master = posix_openpt(O_RDWR | O_NOCTTY);
+  if(master < 0 || grantpt(master) < 0 || unlockpt(master) < 0) {
+    perror("fake_b: pty");
+    return 1;
+  }
+  printf("%s\n", ptsname(master));
+  fflush(stdout);
+  srand(1);
+
+  while(total == 0 || sent < total) {
+    struct timespec gap = { 0, 1000000000L / rate };
+    unsigned origin = 1 + sent % tags;
+    size_t   len = build_set(origin, set_no[origin]++);
+
+    if(rand() % 100 < (int)bad) {
+      if(rand() & 1) line[len - 3] ^= 0x01;       /* checksum digit */
+      else { len /= 2; line[len++] = '\n'; }      /* cut short */
+    }
+    if(sent % 5 == 0) {
+      dprintf(master, "[INFO: NodeB ] Full set received from %u\n", origin);
+    }
+    if(write(master, line, len) < 0) break;
+    sent++;
+    nanosleep(&gap, NULL);
+  }
+  /* let gw drain the pty before the slave side sees the hangup */
+  sleep(1);
+  close(master);
+  fprintf(stderr, "fake_b: %u sets\n", sent);
+  return 0;
+}
@@ -0,0 +1,328 @@
+/*
+ * gw.c – Host gateway: ingests Node B set dumps into a sample store
+ *
+ * usage: gw -d DIR [-b baud] PORT...
+ *
+ * Every PORT is a Node B serial line (or a pty, see fake_b.c).  All ports
+ * are multiplexed with poll() in one thread; each keeps its own line
+ * buffer, so interleaved output of several Node Bs cannot mix.  Lines
+ * other than
+ *
+ *   $SET,<origin>,<collector>,<set_no>,<n>,<n × LLLLMMMMDD hex>*CS
+ *
+ * (node_b_v2.c, SET_DUMP) and the flash log's bulk dump lines
+ *
+ *   $LOG,<seq>,<age_s>,<origin>,<collector>,<set_no>,<n>,<…>*CS
+ *
+ * (SET_LOG, "DUMP" command) are the nodes' log output and are skipped;
+ * a line with a bad checksum or length is counted and dropped.
+ *
+ * Time stamps: Node A samples carry no wall‑clock time, so the line's
+ * host arrival time is taken as the time of the set's last sample and
+ * the earlier ones are placed back from it by their dt gaps.  Sets that
+ * waited in a relay queue are therefore stamped late by that wait.  A
+ * $LOG set is placed age_s before its arrival; one logged before the
+ * node's last reset (age −1) is placed at arrival, which is only an upper
+ * bound, and flagged GW_SET_NO_AGE.  $LOG sets carry the log's seq, so a
+ * set dumped twice, or dumped after it came in live (Node B prints
+ * logged sets as $LOG with age 0), is stored once (store.h).
+ *
+ * Sets are appended to the store (store.h) as they arrive and made
+ * durable every GW_FLUSH_MS or GW_FLUSH_SETS sets, whichever is first,
+ * and on SIGINT / SIGTERM.  A port that closes (USB unplugged, fake
+ * Node B exited) is reopened every GW_REOPEN_MS.  Counters go to stderr
+ * every GW_STATS_MS.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include "store.h"
+
+#define GW_MAX_PORTS     32
+#define GW_LINE_MAX      1024      /* longest $SET line is 22 + 60·10 + 3 */
+#define GW_MAX_SAMPLES   64
+#define GW_TICK_MS       100       /* PROTO_TICK_MS */
+#define GW_FLUSH_MS      1000
+#define GW_FLUSH_SETS    256
+#define GW_REOPEN_MS     5000
+#define GW_STATS_MS      10000
+
+typedef struct {
+  const char *path;
+  int         fd;
+  size_t      len;
+  char        line[GW_LINE_MAX];
+  int         overflow;          /* discard up to the next newline */
+  int64_t     closed_at;
+} gw_port_t;
+
+static gw_port_t ports[GW_MAX_PORTS];
+static int       n_ports;
+static speed_t   baud = B115200;
+static volatile sig_atomic_t stop;
+
+static struct {
+  unsigned long sets, samples, bad, lines, reopen, dup;
+} stats;
+
+static int64_t now_ms(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void on_signal(int sig)
+{
+  (void)sig;
+  stop = 1;
+}
+
+/* ------------ ports ------------ */
+static int port_open(gw_port_t *p)
+{
+  struct termios tio;
+
+  p->fd = open(p->path, O_RDONLY | O_NOCTTY | O_NONBLOCK);
+  if(p->fd < 0) return -1;
+  if(isatty(p->fd) && tcgetattr(p->fd, &tio) == 0) {
+    cfmakeraw(&tio);
+    cfsetispeed(&tio, baud);
+    cfsetospeed(&tio, baud);
+    tio.c_cflag |= CLOCAL | CREAD;
+    tcsetattr(p->fd, TCSANOW, &tio);
+  }
+  p->len = 0;
+  p->overflow = 0;
+  return 0;
+}
+
+static void port_close(gw_port_t *p, int64_t now)
+{
+  fprintf(stderr, "gw: %s closed\n", p->path);
+  close(p->fd);
+  p->fd = -1;
+  p->closed_at = now;
+}
+
+/* ------------ line parsing ------------ */
+static int hexval(char c)
+{
+  if(c >= '0' && c <= '9') return c - '0';
+  if(c >= 'A' && c <= 'F') return c - 'A' + 10;
+  if(c >= 'a' && c <= 'f') return c - 'a' + 10;
+  return -1;
+}
+
+static long hexn(const char *s, int digits)
+{
+  long v = 0;
+  for(int i = 0; i < digits; i++) {
+    int h = hexval(s[i]);
+    if(h < 0) return -1;
+    v = (v << 4) | h;
+  }
+  return v;
+}
+
+/* 1 if the line is a valid $SET / $LOG, 0 if it is another line,
+ * -1 if bad */
+static int parse_set(char *line, int64_t t_rx, gw_store_t *st)
+{
+  unsigned origin, collector, set_no, n;
+  unsigned long seq = 0;
+  long     age = 0;
+  int      used, fields, r;
+  uint8_t  flags = 0;
+  char    *star, *hex;
+  uint8_t  cs = 0;
+  int64_t  t_ms[GW_MAX_SAMPLES];
+  int16_t  light[GW_MAX_SAMPLES], motion[GW_MAX_SAMPLES];
+  uint8_t  dt[GW_MAX_SAMPLES];
+
+  /* the line may follow log output the node printed without a newline */
+  if((hex = strstr(line, "$SET,")) == NULL &&
+     (hex = strstr(line, "$LOG,")) == NULL) {
+    return 0;
+  }
+  line = hex;
+
+  star = strrchr(line, '*');
+  if(star == NULL || hexn(star + 1, 2) < 0) return -1;
+  for(char *c = line + 1; c < star; c++) cs ^= (uint8_t)*c;
+  if(cs != hexn(star + 1, 2)) return -1;
+
+  if(line[1] == 'S') {
+    fields = sscanf(line, "$SET,%u,%u,%u,%u,%n", &origin, &collector,
+                    &set_no, &n, &used) == 4;
+  } else {
+    fields = sscanf(line, "$LOG,%lu,%ld,%u,%u,%u,%u,%n", &seq, &age, &origin,
+                    &collector, &set_no, &n, &used) == 6 && seq <= UINT32_MAX;
+    flags = GW_SET_SEQ | (age < 0 ? GW_SET_NO_AGE : 0);
+  }
+  if(!fields || n == 0 || n > GW_MAX_SAMPLES ||
+     origin > 0xFFFF || collector > 0xFFFF || set_no > 0xFF) {
+    return -1;
+  }
+  hex = line + used;
+  if(star - hex != (long)n * 10) return -1;
+
+  for(unsigned i = 0; i < n; i++, hex += 10) {
+    long l = hexn(hex, 4), m = hexn(hex + 4, 4), d = hexn(hex + 8, 2);
+    if(l < 0 || m < 0 || d < 0) return -1;
+    light[i]  = (int16_t)(uint16_t)l;
+    motion[i] = (int16_t)(uint16_t)m;
+    dt[i]     = (uint8_t)d;
+  }
+  t_ms[n - 1] = age > 0 ? t_rx - (int64_t)age * 1000 : t_rx;
+  for(unsigned i = n - 1; i > 0; i--) t_ms[i - 1] = t_ms[i] - dt[i] * GW_TICK_MS;
+
+  r = gw_store_append(st, origin, collector, set_no, flags, (uint32_t)seq, n,
+                      t_ms, light, motion);
+  if(r < 0) {
+    perror("gw: append");
+    stop = 1;
+    return -1;
+  }
+  if(r > 0) stats.dup++;
+  else stats.samples += n;
+  return 1;
+}
+
+static void port_read(gw_port_t *p, gw_store_t *st, int64_t now)
+{
+  char    buf[512];
+  ssize_t got = read(p->fd, buf, sizeof(buf));
+
+  if(got == 0 || (got < 0 && errno != EAGAIN && errno != EINTR)) {
+    port_close(p, now);
+    return;
+  }
+  for(ssize_t i = 0; i < got; i++) {
+    char c = buf[i];
+    if(c == '\r') continue;
+    if(c != '\n') {
+      if(p->len < GW_LINE_MAX - 1) p->line[p->len++] = c;
+      else p->overflow = 1;
+      continue;
+    }
+    p->line[p->len] = '\0';
+    if(!p->overflow) {
+      int r = parse_set(p->line, now, st);
+      stats.lines++;
+      if(r > 0) stats.sets++;
+      else if(r < 0) stats.bad++;
+    } else {
+      stats.bad++;
+    }
+    p->len = 0;
+    p->overflow = 0;
+  }
+}
+
+static void usage(void)
+{
+  fprintf(stderr, "usage: gw -d DIR [-b baud] PORT...\n");
+  exit(2);
+}
+
+int main(int argc, char **argv)
+{
+  gw_store_t    st;
+  const char   *dir = NULL;
+  struct pollfd pfd[GW_MAX_PORTS];
+  int           opt;
+  unsigned long flushed = 0;
+  int64_t       last_flush, last_stats;
+
+  while((opt = getopt(argc, argv, "d:b:")) != -1) {
+    switch(opt) {
+    case 'd': dir = optarg; break;
+    case 'b':
+      switch(atoi(optarg)) {
+      case 9600:   baud = B9600;   break;
+      case 38400:  baud = B38400;  break;
+      case 57600:  baud = B57600;  break;
+      case 115200: baud = B115200; break;
+      case 460800: baud = B460800; break;
+      default: usage();
+      }
+      break;
+    default: usage();
+    }
+  }
+  if(dir == NULL || optind == argc || argc - optind > GW_MAX_PORTS) usage();
+
+  if(gw_store_open(&st, dir, 1) < 0) {
+    perror(dir);
+    return 1;
+  }
+  for(; optind < argc; optind++) {
+    gw_port_t *p = &ports[n_ports++];
+    p->path = argv[optind];
+    if(port_open(p) < 0) {
+      perror(p->path);
+      p->closed_at = now_ms();
+    }
+  }
+
+  signal(SIGINT, on_signal);
+  signal(SIGTERM, on_signal);
+  signal(SIGHUP, on_signal);
+  last_flush = last_stats = now_ms();
+
+  while(!stop) {
+    int     map[GW_MAX_PORTS], n = 0;
+    int64_t now;
+
+    for(int i = 0; i < n_ports; i++) {
+      if(ports[i].fd < 0) continue;
+      pfd[n].fd = ports[i].fd;
+      pfd[n].events = POLLIN;
+      map[n++] = i;
+    }
+    if(poll(pfd, n, 200) < 0 && errno != EINTR) {
+      perror("gw: poll");
+      break;
+    }
+    now = now_ms();
+    for(int i = 0; i < n; i++) {
+      if(pfd[i].revents & (POLLIN | POLLHUP | POLLERR)) {
+        port_read(&ports[map[i]], &st, now);
+      }
+    }
+
+    if(stats.sets - flushed >= GW_FLUSH_SETS ||
+       (stats.sets != flushed && now - last_flush >= GW_FLUSH_MS)) {
+      if(gw_store_flush(&st) < 0) perror("gw: flush");
+      flushed = stats.sets;
+      last_flush = now;
+    }
+    for(int i = 0; i < n_ports; i++) {
+      if(ports[i].fd < 0 && now - ports[i].closed_at >= GW_REOPEN_MS) {
+        if(port_open(&ports[i]) == 0) stats.reopen++;
+        else ports[i].closed_at = now;
+      }
+    }
+    if(now - last_stats >= GW_STATS_MS) {
+      fprintf(stderr, "gw: sets=%lu samples=%lu bad=%lu dup=%lu lines=%lu "
+              "reopen=%lu stored_sets=%llu\n", stats.sets, stats.samples,
+              stats.bad, stats.dup, stats.lines, stats.reopen,
+              (unsigned long long)st.sets);
+      last_stats = now;
+    }
+  }
+
+  gw_store_close(&st);
+  fprintf(stderr, "gw: sets=%lu samples=%lu bad=%lu\n", stats.sets,
+          stats.samples, stats.bad);
+  return 0;
+}
@@ -0,0 +1,505 @@
+/*
+ * store.c – Append‑only columnar sample store (see store.h)
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "store.h"
+
+#define GW_GROW          (1u << 16)   /* elements added per file growth */
+#define GW_SENDERS       65536
+
+static const char magic[8] = "GWSTORE2";
+
+typedef struct {
+  char     magic[8];
+  uint64_t rows;
+  uint64_t sets;
+  uint64_t late;
+} gw_meta_t;
+
+/* ------------ mapped files ------------ */
+static int map_file(gw_col_t *c, int writable)
+{
+  struct stat sb;
+
+  if(c->base != NULL) munmap(c->base, c->cap * c->elem);
+  c->base = NULL;
+  if(fstat(c->fd, &sb) < 0) return -1;
+  c->cap = sb.st_size / c->elem;
+  if(c->cap == 0) return 0;
+  c->base = mmap(NULL, c->cap * c->elem,
+                 PROT_READ | (writable ? PROT_WRITE : 0), MAP_SHARED,
+                 c->fd, 0);
+  if(c->base == MAP_FAILED) {
+    c->base = NULL;
+    return -1;
+  }
+  return 0;
+}
+
+static int col_open(gw_col_t *c, const char *dir, const char *name,
+                    size_t elem, int writable)
+{
+  char path[PATH_MAX];
+
+  snprintf(path, sizeof(path), "%s/%s", dir, name);
+  c->elem = elem;
+  c->base = NULL;
+  c->cap  = 0;
+  c->fd   = open(path, writable ? O_RDWR | O_CREAT : O_RDONLY, 0644);
+  if(c->fd < 0) return -1;
+  return map_file(c, writable);
+}
+
+/* room for need elements, growing the file (writer only) */
+static int col_reserve(gw_col_t *c, uint64_t need)
+{
+  uint64_t cap;
+
+  if(need <= c->cap) return 0;
+  cap = c->cap * 2;
+  if(cap < need) cap = need;
+  if(cap < GW_GROW) cap = GW_GROW;
+  if(ftruncate(c->fd, cap * c->elem) < 0) return -1;
+  return map_file(c, 1);
+}
+
+static void col_close(gw_col_t *c)
+{
+  if(c->base != NULL) munmap(c->base, c->cap * c->elem);
+  if(c->fd >= 0) close(c->fd);
+  c->base = NULL;
+  c->fd   = -1;
+}
+
+#define COL(c, type)     ((type *)(c).base)
+
+/* ------------ meta ------------ */
+static int meta_read(gw_store_t *st)
+{
+  gw_meta_t m;
+  ssize_t   got = pread(st->meta_fd, &m, sizeof(m), 0);
+
+  if(got == 0) {                        /* new store */
+    st->rows = st->sets = st->late = 0;
+    return 0;
+  }
+  if(got != sizeof(m) || memcmp(m.magic, magic, sizeof(magic)) != 0) {
+    errno = EINVAL;
+    return -1;
+  }
+  st->rows = m.rows;
+  st->sets = m.sets;
+  st->late = m.late;
+  return 0;
+}
+
+/* newest‑set chains, rebuilt from the committed sets after a crash */
+static void senders_rebuild(gw_store_t *st)
+{
+  gw_set_t *idx = COL(st->idx, gw_set_t);
+
+  memset(st->last, 0xFF, GW_SENDERS * sizeof(uint32_t));
+  for(uint64_t i = 0; i < st->sets; i++) {
+    idx[i].prev = st->last[idx[i].sender];
+    st->last[idx[i].sender] = (uint32_t)i;
+  }
+}
+
+/* first in‑order set at or after i */
+static uint64_t main_next(const gw_store_t *st, uint64_t i)
+{
+  const gw_set_t *idx = COL(st->idx, gw_set_t);
+
+  while(i < st->sets && (idx[i].flags & GW_SET_LATE)) i++;
+  return i;
+}
+
+/* first late.idx entry whose set ends at or after t (after t: above) */
+static uint64_t late_find(const gw_store_t *st, int64_t t, int above)
+{
+  const gw_set_t *idx  = COL(st->idx, gw_set_t);
+  const uint32_t *late = COL(st->late_idx, uint32_t);
+  uint64_t lo = 0, hi = st->late;
+
+  while(lo < hi) {
+    uint64_t mid = (lo + hi) / 2;
+    /* an entry past the sets is a writer's insert not yet committed */
+    if(late[mid] >= st->sets || idx[late[mid]].t_last < t ||
+       (above && idx[late[mid]].t_last == t)) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+/* sort late set i into late.idx, after the ones ending no later */
+static int late_insert(gw_store_t *st, uint32_t i)
+{
+  const gw_set_t *idx = COL(st->idx, gw_set_t);
+  uint32_t *late;
+  uint64_t  at;
+
+  if(col_reserve(&st->late_idx, st->late + 1)) return -1;
+  late = COL(st->late_idx, uint32_t);
+  at   = late_find(st, idx[i].t_last, 1);
+  memmove(&late[at + 1], &late[at], (st->late - at) * sizeof(*late));
+  late[at] = i;
+  st->late++;
+  return 0;
+}
+
+/* late.idx from the committed sets: after a crash an insert may have
+ * shifted a committed entry past the committed count */
+static int late_rebuild(gw_store_t *st)
+{
+  const gw_set_t *idx = COL(st->idx, gw_set_t);
+
+  st->late = 0;
+  for(uint64_t i = 0; i < st->sets; i++) {
+    if((idx[i].flags & GW_SET_LATE) && late_insert(st, (uint32_t)i) < 0) {
+      return -1;
+    }
+  }
+  return 0;
+}
+
+/* ------------ log seq hash (writer) ------------ */
+static uint64_t seen_hash(uint16_t sender, uint16_t collector,
+                          uint8_t set_no, uint32_t seq)
+{
+  uint64_t h = ((uint64_t)sender << 48 | (uint64_t)collector << 32 | seq) ^
+               ((uint64_t)set_no << 24);
+  h ^= h >> 33;
+  h *= 0xFF51AFD7ED558CCDULL;
+  h ^= h >> 33;
+  return h;
+}
+
+/* slot of the set with this key, or the free slot it would go to */
+static uint32_t *seen_slot(gw_store_t *st, uint16_t sender,
+                           uint16_t collector, uint8_t set_no, uint32_t seq)
+{
+  const gw_set_t *idx = COL(st->idx, gw_set_t);
+  uint64_t k = seen_hash(sender, collector, set_no, seq) & (st->seen_cap - 1);
+
+  for(;; k = (k + 1) & (st->seen_cap - 1)) {
+    uint32_t i = st->seen[k];
+    if(i == GW_NONE ||
+       (idx[i].seq == seq && idx[i].sender == sender &&
+        idx[i].collector == collector && idx[i].set_no == set_no)) {
+      return &st->seen[k];
+    }
+  }
+}
+
+/* add set i, growing the table to stay at most half full */
+static int seen_add(gw_store_t *st, uint32_t i)
+{
+  const gw_set_t *idx = COL(st->idx, gw_set_t);
+
+  if((st->seen_n + 1) * 2 > st->seen_cap) {
+    uint32_t *old = st->seen;
+    uint64_t  cap = st->seen_cap;
+
+    st->seen_cap = cap ? cap * 2 : GW_GROW;
+    st->seen = malloc(st->seen_cap * sizeof(*st->seen));
+    if(st->seen == NULL) {
+      st->seen = old;
+      st->seen_cap = cap;
+      return -1;
+    }
+    memset(st->seen, 0xFF, st->seen_cap * sizeof(*st->seen));
+    for(uint64_t k = 0; k < cap; k++) {
+      uint32_t j = old[k];
+      if(j == GW_NONE) continue;
+      *seen_slot(st, idx[j].sender, idx[j].collector, idx[j].set_no,
+                 idx[j].seq) = j;
+    }
+    free(old);
+  }
+  *seen_slot(st, idx[i].sender, idx[i].collector, idx[i].set_no,
+             idx[i].seq) = i;
+  st->seen_n++;
+  return 0;
+}
+
+/* ------------ API ------------ */
+int gw_store_open(gw_store_t *st, const char *dir, int writable)
+{
+  char path[PATH_MAX];
+  int  fresh;
+
+  memset(st, 0, sizeof(*st));
+  st->writable = writable;
+  if(writable) mkdir(dir, 0755);
+
+  snprintf(path, sizeof(path), "%s/meta", dir);
+  st->meta_fd = open(path, writable ? O_RDWR | O_CREAT : O_RDONLY, 0644);
+  if(st->meta_fd < 0 || meta_read(st) < 0) return -1;
+
+  if(col_open(&st->ts,     dir, "ts.col",     sizeof(int64_t),  writable) ||
+     col_open(&st->sender, dir, "sender.col", sizeof(uint16_t), writable) ||
+     col_open(&st->light,  dir, "light.col",  sizeof(int16_t),  writable) ||
+     col_open(&st->motion, dir, "motion.col", sizeof(int16_t),  writable) ||
+     col_open(&st->idx,    dir, "sets.idx",   sizeof(gw_set_t), writable) ||
+     col_open(&st->late_idx, dir, "late.idx", sizeof(uint32_t), writable)) {
+    return -1;
+  }
+
+  snprintf(path, sizeof(path), "%s/senders.idx", dir);
+  st->last_fd = open(path, writable ? O_RDWR | O_CREAT : O_RDONLY, 0644);
+  if(st->last_fd < 0) return -1;
+  fresh = lseek(st->last_fd, 0, SEEK_END) == 0;
+  if(fresh && (!writable ||
+               ftruncate(st->last_fd, GW_SENDERS * sizeof(uint32_t)) < 0)) {
+    return -1;
+  }
+  st->last = mmap(NULL, GW_SENDERS * sizeof(uint32_t),
+                  PROT_READ | (writable ? PROT_WRITE : 0), MAP_SHARED,
+                  st->last_fd, 0);
+  if(st->last == MAP_FAILED) return -1;
+
+  if(writable) {
+    /* a chain head past the committed sets: the last run died before
+     * its flush, the entries it points at will be overwritten */
+    int stale = fresh;
+    for(uint32_t s = 0; s < GW_SENDERS && !stale; s++) {
+      stale = st->last[s] != GW_NONE && st->last[s] >= st->sets;
+    }
+    if(stale) senders_rebuild(st);
+
+    const gw_set_t *idx  = COL(st->idx, gw_set_t);
+    const uint32_t *late = COL(st->late_idx, uint32_t);
+    stale = 0;
+    for(uint64_t k = 0; k < st->late && !stale; k++) stale = late[k] >= st->sets;
+    if(stale && late_rebuild(st) < 0) return -1;
+
+    uint64_t i = st->sets;
+    while(i > 0 && (idx[i - 1].flags & GW_SET_LATE)) i--;
+    st->t_max = i > 0 ? idx[i - 1].t_last : INT64_MIN;
+    for(i = 0; i < st->sets; i++) {
+      if((idx[i].flags & GW_SET_SEQ) && seen_add(st, (uint32_t)i) < 0) {
+        return -1;
+      }
+    }
+  }
+  return 0;
+}
+
+void gw_store_close(gw_store_t *st)
+{
+  if(st->writable) gw_store_flush(st);
+  col_close(&st->ts);
+  col_close(&st->sender);
+  col_close(&st->light);
+  col_close(&st->motion);
+  col_close(&st->idx);
+  col_close(&st->late_idx);
+  free(st->seen);
+  if(st->last != NULL && st->last != MAP_FAILED) {
+    munmap(st->last, GW_SENDERS * sizeof(uint32_t));
+  }
+  if(st->last_fd >= 0) close(st->last_fd);
+  if(st->meta_fd >= 0) close(st->meta_fd);
+}
+
+int gw_store_append(gw_store_t *st, uint16_t sender, uint16_t collector,
+                    uint8_t set_no, uint8_t flags, uint32_t seq,
+                    uint16_t n, const int64_t *t_ms,
+                    const int16_t *light, const int16_t *motion)
+{
+  uint64_t  r = st->rows;
+  gw_set_t *set;
+
+  if(n == 0) return 0;
+  if((flags & GW_SET_SEQ) && st->seen_cap != 0 &&
+     *seen_slot(st, sender, collector, set_no, seq) != GW_NONE) {
+    return 1;
+  }
+  if(col_reserve(&st->ts, r + n) || col_reserve(&st->sender, r + n) ||
+     col_reserve(&st->light, r + n) || col_reserve(&st->motion, r + n) ||
+     col_reserve(&st->idx, st->sets + 1)) {
+    return -1;
+  }
+
+  memcpy(&COL(st->ts, int64_t)[r],     t_ms,   n * sizeof(int64_t));
+  memcpy(&COL(st->light, int16_t)[r],  light,  n * sizeof(int16_t));
+  memcpy(&COL(st->motion, int16_t)[r], motion, n * sizeof(int16_t));
+  for(uint16_t i = 0; i < n; i++) COL(st->sender, uint16_t)[r + i] = sender;
+
+  set = &COL(st->idx, gw_set_t)[st->sets];
+  set->sender    = sender;
+  set->collector = collector;
+  set->set_no    = set_no;
+  set->flags     = flags & (GW_SET_SEQ | GW_SET_NO_AGE);
+  set->n         = n;
+  set->prev      = st->last[sender];
+  set->seq       = flags & GW_SET_SEQ ? seq : 0;
+  set->t_first   = t_ms[0];
+  set->t_last    = t_ms[n - 1];
+  set->row       = r;
+  if(set->t_last < st->t_max) {
+    set->flags |= GW_SET_LATE;
+    if(late_insert(st, (uint32_t)st->sets) < 0) return -1;
+  } else {
+    st->t_max = set->t_last;
+  }
+  if((flags & GW_SET_SEQ) && seen_add(st, (uint32_t)st->sets) < 0) {
+    return -1;
+  }
+  st->last[sender] = (uint32_t)st->sets;
+
+  st->rows += n;
+  st->sets++;
+  return 0;
+}
+
+int gw_store_flush(gw_store_t *st)
+{
+  gw_col_t *cols[] = { &st->ts, &st->sender, &st->light, &st->motion,
+                       &st->idx, &st->late_idx };
+  gw_meta_t m;
+
+  for(size_t i = 0; i < sizeof(cols) / sizeof(cols[0]); i++) {
+    if(cols[i]->base != NULL &&
+       msync(cols[i]->base, cols[i]->cap * cols[i]->elem, MS_SYNC) < 0) {
+      return -1;
+    }
+  }
+  memcpy(m.magic, magic, sizeof(magic));
+  m.rows = st->rows;
+  m.sets = st->sets;
+  m.late = st->late;
+  if(pwrite(st->meta_fd, &m, sizeof(m), 0) != sizeof(m)) return -1;
+  if(fdatasync(st->meta_fd) < 0) return -1;
+  return msync(st->last, GW_SENDERS * sizeof(uint32_t), MS_ASYNC);
+}
+
+int gw_store_refresh(gw_store_t *st)
+{
+  gw_col_t *cols[] = { &st->ts, &st->sender, &st->light, &st->motion,
+                       &st->idx, &st->late_idx };
+
+  if(meta_read(st) < 0) return -1;
+  for(size_t i = 0; i < sizeof(cols) / sizeof(cols[0]); i++) {
+    uint64_t need = cols[i] == &st->idx ? st->sets :
+                    cols[i] == &st->late_idx ? st->late : st->rows;
+    if(need > cols[i]->cap && map_file(cols[i], st->writable) < 0) return -1;
+  }
+  return 0;
+}
+
+static uint64_t scan_set(gw_store_t *st, const gw_set_t *set, int64_t from,
+                         int64_t to, gw_set_fn set_fn, gw_row_fn row_fn,
+                         void *arg)
+{
+  const int64_t *ts = COL(st->ts, int64_t);
+  uint64_t hits = 0;
+
+  if(set->row + set->n > st->rows) return 0;
+  if(set_fn != NULL) set_fn(arg, set);
+  for(uint64_t r = set->row; r < set->row + set->n; r++) {
+    if(ts[r] < from || ts[r] > to) continue;
+    hits++;
+    if(row_fn != NULL) {
+      row_fn(arg, ts[r], set->sender, COL(st->light, int16_t)[r],
+             COL(st->motion, int16_t)[r]);
+    }
+  }
+  return hits;
+}
+
+typedef struct {
+  int64_t  t_last;
+  uint32_t i;
+} gw_hit_t;
+
+static int hit_cmp(const void *a, const void *b)
+{
+  const gw_hit_t *x = a, *y = b;
+
+  if(x->t_last != y->t_last) return x->t_last < y->t_last ? -1 : 1;
+  return x->i < y->i ? -1 : x->i > y->i;
+}
+
+uint64_t gw_store_scan(gw_store_t *st, int sender, int64_t from, int64_t to,
+                       gw_set_fn set_fn, gw_row_fn row_fn, void *arg)
+{
+  const gw_set_t *idx  = COL(st->idx, gw_set_t);
+  const uint32_t *late = COL(st->late_idx, uint32_t);
+  uint64_t hits = 0;
+
+  if(st->sets == 0) return 0;
+
+  if(sender >= 0) {
+    /* walk the sender's chain back to from, then report oldest first;
+     * only an in‑order set ending before from ends the walk, a late one
+     * may be followed by older sets that are in range */
+    gw_hit_t *hit = NULL;
+    size_t    n = 0, cap = 0;
+
+    for(uint32_t i = st->last[sender & 0xFFFF]; i != GW_NONE; i = idx[i].prev) {
+      if(i >= st->sets) continue;        /* appended after the last flush */
+      if(idx[i].t_last < from) {
+        if(idx[i].flags & GW_SET_LATE) continue;
+        break;
+      }
+      if(idx[i].t_first > to) continue;
+      if(n == cap) {
+        cap = cap ? cap * 2 : 64;
+        gw_hit_t *grown = realloc(hit, cap * sizeof(*hit));
+        if(grown == NULL) break;
+        hit = grown;
+      }
+      hit[n].t_last = idx[i].t_last;
+      hit[n++].i    = i;
+    }
+    qsort(hit, n, sizeof(*hit), hit_cmp);
+    for(size_t k = 0; k < n; k++) {
+      hits += scan_set(st, &idx[hit[k].i], from, to, set_fn, row_fn, arg);
+    }
+    free(hit);
+    return hits;
+  }
+
+  /* all senders: t_last does not decrease over the in‑order sets, and
+   * late.idx is sorted by it, so both start at from and are merged */
+  uint64_t lo = 0, hi = st->sets, i, j;
+  while(lo < hi) {
+    uint64_t mid = (lo + hi) / 2, k = main_next(st, mid);
+    if(k < st->sets && idx[k].t_last < from) lo = k + 1; else hi = mid;
+  }
+  i = main_next(st, lo);
+  j = late_find(st, from, 0);
+  for(;;) {
+    const gw_set_t *a = NULL, *b = NULL, *set;
+
+    while(j < st->late && late[j] >= st->sets) j++;
+    if(i < st->sets && idx[i].t_last <= to + GW_MAX_SPAN_MS) a = &idx[i];
+    if(j < st->late && idx[late[j]].t_last <= to + GW_MAX_SPAN_MS) {
+      b = &idx[late[j]];
+    }
+    if(a == NULL && b == NULL) break;              /* starts after to */
+    if(b == NULL || (a != NULL && a->t_last <= b->t_last)) {
+      set = a;
+      i = main_next(st, i + 1);
+    } else {
+      set = b;
+      j++;
+    }
+    if(set->t_first > to) continue;
+    hits += scan_set(st, set, from, to, set_fn, row_fn, arg);
+  }
+  return hits;
+}
@@ -0,0 +1,106 @@
+/*
+ * store.h – Append‑only columnar sample store for the host gateway
+ *
+ * One directory per store:
+ *
+ *   meta         committed row / set / late counts (written last on a
+ *                flush)
+ *   ts.col       int64  sample time, ms since the epoch
+ *   sender.col   uint16 Node A id
+ *   light.col    int16
+ *   motion.col   int16
+ *   sets.idx     gw_set_t per set, in arrival order
+ *   late.idx     uint32 per late set, ordered by t_last
+ *   senders.idx  uint32[65536] newest set per sender (chain via prev)
+ *
+ * Every file is mmap'ed and grown in GW_GROW steps.  Appends only touch
+ * the maps; gw_store_flush() msyncs them and then commits the counts in
+ * meta, so after a crash the store ends at the last flush.
+ *
+ * Lookups: a sender's sets are a linked list from senders.idx back in
+ * arrival order; a time range is found by binary search on t_last.
+ * Live sets arrive in time order, but a set that ends before one already
+ * stored (a flash log dump, a clock stepped back) is flagged
+ * GW_SET_LATE and also kept in late.idx, sorted into place, so the
+ * in‑order sets of sets.idx keep t_last non‑decreasing.  Scans merge
+ * the two by t_last.
+ *
+ * A set with a log seq (GW_SET_SEQ) is stored once: appending it again
+ * with the same sender, collector, set_no and seq – a second dump, or a
+ * dump of sets already seen live – is skipped.  The writer keeps an
+ * in‑memory hash of those keys, built when the store is opened.
+ */
+
+#ifndef GW_STORE_H_
+#define GW_STORE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define GW_NONE          UINT32_MAX
+#define GW_MAX_SPAN_MS   (60LL * 255 * 100)   /* longest possible set */
+
+/* gw_set_t.flags */
+#define GW_SET_LATE      0x01     /* ends before an earlier arrival */
+#define GW_SET_SEQ       0x02     /* seq is the node's set log seq */
+#define GW_SET_NO_AGE    0x04     /* logged before a node reset: the
+                                     times are only an upper bound */
+
+typedef struct {
+  uint16_t sender;
+  uint16_t collector;
+  uint8_t  set_no;
+  uint8_t  flags;          /* GW_SET_… */
+  uint16_t n;
+  uint32_t prev;           /* previous set of this sender, GW_NONE */
+  uint32_t seq;            /* with GW_SET_SEQ */
+  int64_t  t_first;        /* ms since the epoch */
+  int64_t  t_last;
+  uint64_t row;            /* first row in the columns */
+} gw_set_t;
+
+typedef struct {
+  int      fd;
+  void    *base;
+  size_t   elem;
+  uint64_t cap;            /* elements the file holds */
+} gw_col_t;
+
+typedef struct {
+  int      meta_fd;
+  int      writable;
+  uint64_t rows;
+  uint64_t sets;
+  uint64_t late;
+  gw_col_t ts, sender, light, motion, idx, late_idx;
+  uint32_t *last;          /* senders.idx */
+  int       last_fd;
+  int64_t   t_max;         /* newest t_last of the in‑order sets */
+  uint32_t *seen;          /* writer: hash of the GW_SET_SEQ sets */
+  uint64_t  seen_cap, seen_n;
+} gw_store_t;
+
+int  gw_store_open(gw_store_t *st, const char *dir, int writable);
+void gw_store_close(gw_store_t *st);
+
+/* append one set of n samples; t_ms[i] per sample, flags GW_SET_SEQ /
+ * GW_SET_NO_AGE.  0 on success, 1 if the set is already stored */
+int  gw_store_append(gw_store_t *st, uint16_t sender, uint16_t collector,
+                     uint8_t set_no, uint8_t flags, uint32_t seq,
+                     uint16_t n, const int64_t *t_ms,
+                     const int16_t *light, const int16_t *motion);
+/* make everything appended so far durable and visible to readers */
+int  gw_store_flush(gw_store_t *st);
+
+/* re‑read the committed counts (readers of a live store) */
+int  gw_store_refresh(gw_store_t *st);
+
+/* call fn for every committed sample of sender (‑1: all) in [from, to],
+ * sets oldest (by t_last) first */
+typedef void (*gw_row_fn)(void *arg, int64_t t_ms, uint16_t sender,
+                          int16_t light, int16_t motion);
+typedef void (*gw_set_fn)(void *arg, const gw_set_t *set);
+uint64_t gw_store_scan(gw_store_t *st, int sender, int64_t from, int64_t to,
+                       gw_set_fn set_fn, gw_row_fn row_fn, void *arg);
+
+#endif /* GW_STORE_H_ */
@@ -0,0 +1,25 @@
+/*
+ * board-peripherals.h – SensorTag sensor stand‑ins for the native build
+ *
+ * Provides opt_3001_sensor and mpu_9250_sensor with the SensorTag
+ * interface; values come from the replayed trace (see
+ * sensor_replay.h).  Only the parts the firmwares use are defined.
+ */
+
+#ifndef BOARD_PERIPHERALS_H_
+#define BOARD_PERIPHERALS_H_
+
+#include "lib/sensors.h"
+
+#define MPU_9250_SENSOR_TYPE_ACC_X   0x01
+#define MPU_9250_SENSOR_TYPE_ACC_Y   0x02
+#define MPU_9250_SENSOR_TYPE_ACC_Z   0x04
+#define MPU_9250_SENSOR_TYPE_ACC     0x07
+#define MPU_9250_SENSOR_TYPE_ALL     0x3F
+
+#define CC26XX_SENSOR_READING_ERROR  0x80000000
+
+extern const struct sensors_sensor opt_3001_sensor;
+extern const struct sensors_sensor mpu_9250_sensor;
+
+#endif /* BOARD_PERIPHERALS_H_ */
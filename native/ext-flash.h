@@ -0,0 +1,25 @@
+/*
+ * ext-flash.h – SensorTag external flash stand‑in for the native build
+ *
+ * Same calls as the board's SPI flash driver, backed by a file
+ * (sim_flash.c).  conf is ignored; pass NULL as on the SensorTag.
+ */
+
+#ifndef EXT_FLASH_H_
+#define EXT_FLASH_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct spi_device spi_device_t;
+
+bool ext_flash_open(const spi_device_t *conf);
+bool ext_flash_close(const spi_device_t *conf);
+bool ext_flash_read(const spi_device_t *conf, uint32_t offset,
+                    uint32_t length, uint8_t *buf);
+bool ext_flash_write(const spi_device_t *conf, uint32_t offset,
+                     uint32_t length, const uint8_t *buf);
+bool ext_flash_erase(const spi_device_t *conf, uint32_t offset,
+                     uint32_t length);
+
+#endif /* EXT_FLASH_H_ */
@@ -0,0 +1,103 @@
+/*
+ * sensor_replay.c – Replay backend of the sample source
+ *                   (see sensor_replay.h, sensor_src.h)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "contiki.h"
+#include "sensor_src.h"
+#include "sensor_replay.h"
+
+#define REPLAY_MAX       (8 * 3600)       /* records kept from the trace */
+
+static sensor_record_t trace[REPLAY_MAX];
+static unsigned  trace_len  = 0;
+static uint32_t  trace_span = 0;          /* loop length in ms */
+static unsigned  cursor     = 0;
+static uint8_t   step_mode  = 0;
+static uint8_t   loaded     = 0;
+static clock_time_t t0;
+
+static void load_trace(void)
+{
+  char line[128];
+  const char *path = getenv("SENSOR_REPLAY_TRACE");
+  const char *step = getenv("SENSOR_REPLAY_STEP");
+
+  loaded    = 1;
+  t0        = clock_time();
+  step_mode = step != NULL && atoi(step) != 0;
+  if(path == NULL) return;
+
+  FILE *f = fopen(path, "r");
+  if(f == NULL) {
+    fprintf(stderr, "sensor_replay: cannot open %s\n", path);
+    return;
+  }
+  while(trace_len < REPLAY_MAX && fgets(line, sizeof(line), f)) {
+    sensor_record_t *r = &trace[trace_len];
+    if(line[0] == '#') continue;
+    if(sscanf(line, "%u %d %d %d %d", &r->t_ms, &r->light,
+              &r->acc[0], &r->acc[1], &r->acc[2]) == 5) {
+      trace_len++;
+    }
+  }
+  fclose(f);
+
+  if(trace_len > 0) {
+    /* last record lasts as long as the one before it */
+    uint32_t last = trace[trace_len - 1].t_ms;
+    uint32_t prev = trace_len > 1 ? trace[trace_len - 2].t_ms : 0;
+    trace_span = last + (last > prev ? last - prev : 1000);
+  }
+  printf("sensor_replay: %u records, %lu ms, %s x%d\n", trace_len,
+         (unsigned long)trace_span, step_mode ? "step" : "clock",
+         SENSOR_SRC_SPEEDUP);
+}
+
+const sensor_record_t *sensor_replay_current(void)
+{
+  static const sensor_record_t zero;
+
+  if(!loaded) load_trace();
+  if(trace_len == 0) return &zero;
+
+  if(!step_mode) {
+    uint64_t ms = (uint64_t)(clock_time() - t0) * 1000 / CLOCK_SECOND;
+    uint32_t t  = (uint32_t)((ms * SENSOR_SRC_SPEEDUP) % trace_span);
+
+    if(t < trace[cursor].t_ms) cursor = 0;              /* wrapped */
+    while(cursor + 1 < trace_len && trace[cursor + 1].t_ms <= t) {
+      cursor++;
+    }
+  }
+  return &trace[cursor];
+}
+
+/* ------------ sensor_src backend ------------ */
+#if SENSOR_SRC_REPLAY
+
+void sensor_src_init(void)
+{
+  if(!loaded) load_trace();
+}
+
+void sensor_src_tick(void)
+{
+  if(!loaded) load_trace();
+  if(step_mode && trace_len > 0) cursor = (cursor + 1) % trace_len;
+}
+
+int16_t sensor_src_light(void)
+{
+  return (int16_t)sensor_replay_current()->light;
+}
+
+int16_t sensor_src_motion(void)
+{
+  const sensor_record_t *r = sensor_replay_current();
+  return sensor_src_magnitude(r->acc[0], r->acc[1], r->acc[2]);
+}
+
+#endif /* SENSOR_SRC_REPLAY */
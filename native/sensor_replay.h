@@ -0,0 +1,30 @@
+/*
+ * sensor_replay.h – Trace replay for the native build
+ *
+ * $SENSOR_REPLAY_TRACE names a text file with one record per line:
+ *
+ *      <t_ms> <light> <acc_x> <acc_y> <acc_z>      # '#' starts a comment
+ *
+ * t_ms is the record's offset into the trace (ascending); readings are
+ * in SensorTag driver units (light in lux * 100, acc in 16384 / g).
+ * The trace loops.  Without a trace every reading is 0.
+ *
+ * By default the current record follows the clock, scaled by
+ * SENSOR_SRC_SPEEDUP.  With SENSOR_REPLAY_STEP=1 it instead advances one
+ * record per sensor_src_tick(), independent of timing jitter.
+ */
+
+#ifndef SENSOR_REPLAY_H_
+#define SENSOR_REPLAY_H_
+
+#include <stdint.h>
+
+typedef struct {
+  uint32_t t_ms;
+  int      light;
+  int      acc[3];
+} sensor_record_t;
+
+const sensor_record_t *sensor_replay_current(void);
+
+#endif /* SENSOR_REPLAY_H_ */
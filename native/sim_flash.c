@@ -0,0 +1,106 @@
+/*
+ * sim_flash.c – File‑backed external flash for the native build
+ *
+ * Environment
+ * ----------
+ *   SIM_FLASH         backing file            (default flash-<node id>.bin)
+ *
+ * The file keeps its contents across runs, so a Node B restarted by the
+ * harness finds its set log again.  NOR semantics: erase sets whole
+ * 4 kB sectors to 0xFF and a write can only clear bits, as on the
+ * SensorTag's flash.  Accesses outside SIM_FLASH_SIZE fail.
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "contiki.h"
+#include "sys/node-id.h"
+#include "ext-flash.h"
+
+#define SIM_FLASH_SIZE    (1024UL * 1024)   /* 8 Mbit, as the SensorTag */
+#define SIM_FLASH_SECTOR  4096
+
+static int fd = -1;
+
+static bool range_ok(uint32_t offset, uint32_t length)
+{
+  return fd >= 0 && offset <= SIM_FLASH_SIZE &&
+         length <= SIM_FLASH_SIZE - offset;
+}
+
+bool ext_flash_open(const spi_device_t *conf)
+{
+  char path[64];
+  const char *name = getenv("SIM_FLASH");
+  off_t size;
+
+  if(fd >= 0) return true;
+  if(name == NULL) {
+    snprintf(path, sizeof(path), "flash-%u.bin", node_id);
+    name = path;
+  }
+  fd = open(name, O_RDWR | O_CREAT, 0644);
+  if(fd < 0) {
+    perror("sim_flash: open");
+    return false;
+  }
+  /* a new chip comes erased */
+  size = lseek(fd, 0, SEEK_END);
+  if(size < (off_t)SIM_FLASH_SIZE) {
+    uint8_t ff[SIM_FLASH_SECTOR];
+    memset(ff, 0xFF, sizeof(ff));
+    for(off_t at = size; at < (off_t)SIM_FLASH_SIZE; at += sizeof(ff)) {
+      if(pwrite(fd, ff, sizeof(ff), at) != sizeof(ff)) return false;
+    }
+  }
+  return true;
+}
+
+/* the file stays open; the chip would only power down */
+bool ext_flash_close(const spi_device_t *conf)
+{
+  return fd >= 0;
+}
+
+bool ext_flash_read(const spi_device_t *conf, uint32_t offset,
+                    uint32_t length, uint8_t *buf)
+{
+  return range_ok(offset, length) &&
+         pread(fd, buf, length, offset) == (ssize_t)length;
+}
+
+bool ext_flash_write(const spi_device_t *conf, uint32_t offset,
+                     uint32_t length, const uint8_t *buf)
+{
+  uint8_t cur[256];
+
+  if(!range_ok(offset, length)) return false;
+  while(length) {
+    uint32_t k = length < sizeof(cur) ? length : sizeof(cur);
+    if(pread(fd, cur, k, offset) != (ssize_t)k) return false;
+    for(uint32_t i = 0; i < k; i++) cur[i] &= buf[i];
+    if(pwrite(fd, cur, k, offset) != (ssize_t)k) return false;
+    offset += k;
+    buf    += k;
+    length -= k;
+  }
+  return true;
+}
+
+bool ext_flash_erase(const spi_device_t *conf, uint32_t offset,
+                     uint32_t length)
+{
+  uint8_t ff[SIM_FLASH_SECTOR];
+  uint32_t end = offset + length;
+
+  if(!range_ok(offset, length)) return false;
+  memset(ff, 0xFF, sizeof(ff));
+  offset -= offset % SIM_FLASH_SECTOR;
+  for(; offset < end; offset += SIM_FLASH_SECTOR) {
+    if(pwrite(fd, ff, sizeof(ff), offset) != sizeof(ff)) return false;
+  }
+  return true;
+}
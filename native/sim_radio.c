@@ -0,0 +1,327 @@
+/*
+ * sim_radio.c – Simulated radio medium for the native build
+ *
+ * Every node process joins one UDP multicast group on the loopback
+ * interface; a transmitted frame reaches every other process, which
+ * drops it if its radio is off or by the configured loss rate.
+ *
+ * Environment
+ * ----------
+ *   SIM_NODE_ID       node id; link address is {id >> 8, id & 0xff}
+ *   SIM_PORT          UDP port of the medium          (default 20042)
+ *   SIM_LOSS          receive loss in percent          (default 0)
+ *   SIM_RSSI          RSSI reported for received frames (default -60)
+ *   SIM_RSSI_JITTER   ± uniform jitter on SIM_RSSI     (default 0)
+ *   SIM_SEED          PRNG seed, mixed with the node id (default 1)
+ *
+ * Unicast frames are acknowledged locally, as if by hardware auto‑ACK,
+ * so CSMA never retransmits; all reliability comes from the protocol.
+ *
+ * The driver also measures radio‑on time (RX windows plus TX airtime at
+ * 250 kbit/s) and prints a "SIM ..." stats line every SIM_STATS_INTERVAL
+ * and at exit for native/run_harness.sh.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include "contiki.h"
+#include "dev/radio.h"
+#include "net/netstack.h"
+#include "net/packetbuf.h"
+#include "net/linkaddr.h"
+#include "sys/node-id.h"
+
+/* ------------ parameters ------------ */
+#define SIM_GROUP            "239.255.0.42"
+#define SIM_DEFAULT_PORT     20042
+#define SIM_MAX_FRAME        127
+#define SIM_ACK_LEN          3
+#define SIM_US_PER_BYTE      32            /* 250 kbit/s */
+#define SIM_TX_OVERHEAD      6             /* preamble + SFD + PHR bytes */
+#define SIM_STATS_INTERVAL   (10 * CLOCK_SECOND)
+
+/* ------------ medium frame ------------ */
+typedef struct __attribute__((packed)) {
+  uint16_t src;                    /* SIM_NODE_ID of the sender */
+  uint8_t  frame[SIM_MAX_FRAME];
+} sim_frame_t;
+
+/* ------------ state ------------ */
+static int      sock = -1;
+static struct sockaddr_in group;
+static uint16_t sim_id;
+static int      loss_pct, rssi, rssi_jitter;
+
+static uint8_t  tx_buf[SIM_MAX_FRAME];
+static uint16_t tx_len;
+static uint8_t  ack_buf[SIM_ACK_LEN];
+static uint8_t  ack_pending = 0;
+
+static uint8_t  radio_on = 0;
+static uint64_t on_since_us;
+static uint64_t on_total_us;
+static unsigned long tx_cnt, rx_cnt, lost_cnt, off_cnt;
+
+PROCESS(sim_radio_process, "sim radio");
+
+/* ------------ helpers ------------ */
+static uint64_t now_us(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000u + ts.tv_nsec / 1000;
+}
+
+static int env_int(const char *name, int dflt)
+{
+  const char *v = getenv(name);
+  return v ? atoi(v) : dflt;
+}
+
+static unsigned long radio_on_ms(void)
+{
+  uint64_t t = on_total_us;
+  if(radio_on) t += now_us() - on_since_us;
+  return (unsigned long)(t / 1000);
+}
+
+static void print_stats(void)
+{
+  printf("SIM node=%u t=%lu radio_on_ms=%lu tx=%lu rx=%lu lost=%lu off=%lu\n",
+         sim_id, clock_seconds(), radio_on_ms(),
+         tx_cnt, rx_cnt, lost_cnt, off_cnt);
+  fflush(stdout);
+}
+
+static void on_signal(int sig)
+{
+  exit(0);                          /* runs print_stats via atexit */
+}
+
+/* ------------ radio driver ------------ */
+static int init(void)
+{
+  linkaddr_t addr;
+  int one = 1;
+
+  sim_id      = (uint16_t)env_int("SIM_NODE_ID", 1);
+  loss_pct    = env_int("SIM_LOSS", 0);
+  rssi        = env_int("SIM_RSSI", -60);
+  rssi_jitter = env_int("SIM_RSSI_JITTER", 0);
+  srand((unsigned)env_int("SIM_SEED", 1) * 7919u + sim_id);
+
+  memset(&addr, 0, sizeof(addr));
+  addr.u8[0] = sim_id >> 8;
+  addr.u8[1] = sim_id & 0xff;
+  linkaddr_set_node_addr(&addr);
+  node_id = sim_id;
+
+  sock = socket(AF_INET, SOCK_DGRAM, 0);
+  if(sock < 0) { perror("sim_radio: socket"); exit(1); }
+  setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  setsockopt(sock, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one));
+
+  memset(&group, 0, sizeof(group));
+  group.sin_family = AF_INET;
+  group.sin_port   = htons(env_int("SIM_PORT", SIM_DEFAULT_PORT));
+  group.sin_addr.s_addr = inet_addr(SIM_GROUP);
+
+  struct sockaddr_in any = group;
+  any.sin_addr.s_addr = htonl(INADDR_ANY);
+  if(bind(sock, (struct sockaddr *)&any, sizeof(any)) < 0) {
+    perror("sim_radio: bind"); exit(1);
+  }
+
+  struct ip_mreq mreq;
+  struct in_addr lo;
+  lo.s_addr = htonl(INADDR_LOOPBACK);
+  mreq.imr_multiaddr = group.sin_addr;
+  mreq.imr_interface = lo;
+  setsockopt(sock, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq));
+  setsockopt(sock, IPPROTO_IP, IP_MULTICAST_IF, &lo, sizeof(lo));
+  setsockopt(sock, IPPROTO_IP, IP_MULTICAST_LOOP, &one, sizeof(one));
+  fcntl(sock, F_SETFL, O_NONBLOCK);
+
+  atexit(print_stats);
+  signal(SIGTERM, on_signal);
+  signal(SIGINT, on_signal);
+
+  process_start(&sim_radio_process, NULL);
+  return 1;
+}
+
+static int prepare(const void *payload, unsigned short len)
+{
+  if(len > SIM_MAX_FRAME) return RADIO_TX_ERR;
+  memcpy(tx_buf, payload, len);
+  tx_len = len;
+  return 0;
+}
+
+static int transmit(unsigned short len)
+{
+  sim_frame_t f;
+
+  f.src = sim_id;
+  memcpy(f.frame, tx_buf, tx_len);
+  sendto(sock, &f, sizeof(f.src) + tx_len, 0,
+         (struct sockaddr *)&group, sizeof(group));
+  tx_cnt++;
+
+  /* TX airtime counts as radio‑on even if RX was off */
+  on_total_us += (uint64_t)(tx_len + SIM_TX_OVERHEAD) * SIM_US_PER_BYTE;
+
+  /* auto‑ACK for unicast data frames (FCF: type data, ack request) */
+  if((tx_buf[0] & 0x07) == 0x01 && (tx_buf[0] & 0x20)) {
+    ack_buf[0] = 0x02;
+    ack_buf[1] = 0x00;
+    ack_buf[2] = tx_buf[2];          /* sequence number */
+    ack_pending = 1;
+  }
+  return RADIO_TX_OK;
+}
+
+static int send_frame(const void *payload, unsigned short len)
+{
+  prepare(payload, len);
+  return transmit(len);
+}
+
+static int read_frame(void *buf, unsigned short buf_len)
+{
+  if(!ack_pending || buf_len < SIM_ACK_LEN) return 0;
+  ack_pending = 0;
+  memcpy(buf, ack_buf, SIM_ACK_LEN);
+  return SIM_ACK_LEN;
+}
+
+static int channel_clear(void)    { return 1; }
+static int receiving_packet(void) { return 0; }
+static int pending_packet(void)   { return ack_pending; }
+
+static int on(void)
+{
+  if(!radio_on) {
+    radio_on = 1;
+    on_since_us = now_us();
+  }
+  return 1;
+}
+
+static int off(void)
+{
+  if(radio_on) {
+    radio_on = 0;
+    on_total_us += now_us() - on_since_us;
+  }
+  return 1;
+}
+
+static radio_result_t get_value(radio_param_t param, radio_value_t *value)
+{
+  switch(param) {
+  case RADIO_PARAM_POWER_MODE:
+    *value = radio_on ? RADIO_POWER_MODE_ON : RADIO_POWER_MODE_OFF;
+    return RADIO_RESULT_OK;
+  case RADIO_PARAM_LAST_RSSI:
+    *value = rssi;
+    return RADIO_RESULT_OK;
+  case RADIO_CONST_MAX_PAYLOAD_LEN:
+    *value = SIM_MAX_FRAME - 2;       /* minus FCS */
+    return RADIO_RESULT_OK;
+  default:
+    return RADIO_RESULT_NOT_SUPPORTED;
+  }
+}
+
+static radio_result_t set_value(radio_param_t param, radio_value_t value)
+{
+  if(param == RADIO_PARAM_POWER_MODE) {
+    if(value == RADIO_POWER_MODE_ON) on(); else off();
+    return RADIO_RESULT_OK;
+  }
+  return RADIO_RESULT_NOT_SUPPORTED;
+}
+
+static radio_result_t get_object(radio_param_t param, void *dest, size_t size)
+{
+  return RADIO_RESULT_NOT_SUPPORTED;
+}
+
+static radio_result_t set_object(radio_param_t param, const void *src,
+                                 size_t size)
+{
+  return RADIO_RESULT_NOT_SUPPORTED;
+}
+
+const struct radio_driver sim_radio_driver = {
+  .init             = init,
+  .prepare          = prepare,
+  .transmit         = transmit,
+  .send             = send_frame,
+  .read             = read_frame,
+  .channel_clear    = channel_clear,
+  .receiving_packet = receiving_packet,
+  .pending_packet   = pending_packet,
+  .on               = on,
+  .off              = off,
+  .get_value        = get_value,
+  .set_value        = set_value,
+  .get_object       = get_object,
+  .set_object       = set_object,
+};
+
+/* ------------ receive: drain the medium once per clock tick ------------ */
+static void deliver(const sim_frame_t *f, int len)
+{
+  if(f->src == sim_id) return;                    /* own frame */
+  if(!radio_on) { off_cnt++; return; }
+  if(loss_pct > 0 && rand() % 100 < loss_pct) { lost_cnt++; return; }
+
+  int r = rssi;
+  if(rssi_jitter > 0) r += rand() % (2 * rssi_jitter + 1) - rssi_jitter;
+
+  packetbuf_clear();
+  memcpy(packetbuf_dataptr(), f->frame, len);
+  packetbuf_set_datalen(len);
+  packetbuf_set_attr(PACKETBUF_ATTR_RSSI, (packetbuf_attr_t)r);
+  rx_cnt++;
+  NETSTACK_MAC.input();
+}
+
+PROCESS_THREAD(sim_radio_process, ev, data)
+{
+  static struct etimer poll_timer, stats_timer;
+  static sim_frame_t f;
+  int n;
+
+  PROCESS_BEGIN();
+
+  etimer_set(&poll_timer, 1);
+  etimer_set(&stats_timer, SIM_STATS_INTERVAL);
+
+  while(1) {
+    PROCESS_WAIT_EVENT_UNTIL(ev == PROCESS_EVENT_TIMER);
+
+    if(etimer_expired(&poll_timer)) {
+      while((n = recv(sock, &f, sizeof(f), 0)) > (int)sizeof(f.src)) {
+        deliver(&f, n - sizeof(f.src));
+      }
+      etimer_reset(&poll_timer);
+    }
+    if(etimer_expired(&stats_timer)) {
+      print_stats();
+      etimer_reset(&stats_timer);
+    }
+  }
+
+  PROCESS_END();
+}
@@ -0,0 +1,43 @@
+/*
+ * sim_sensors.c – SensorTag sensor stand‑ins for the native build
+ *
+ * opt_3001_sensor / mpu_9250_sensor return the current record of the
+ * replayed trace (see sensor_replay.h), for firmwares that still read
+ * the board sensors directly.
+ */
+
+#include "contiki.h"
+#include "board-peripherals.h"
+#include "sensor_replay.h"
+
+/* ------------ OPT3001 ------------ */
+static int opt_value(int type)
+{
+  return sensor_replay_current()->light;
+}
+
+/* ------------ MPU9250 ------------ */
+static int mpu_value(int type)
+{
+  const sensor_record_t *r = sensor_replay_current();
+
+  switch(type) {
+  case MPU_9250_SENSOR_TYPE_ACC_X: return r->acc[0];
+  case MPU_9250_SENSOR_TYPE_ACC_Y: return r->acc[1];
+  case MPU_9250_SENSOR_TYPE_ACC_Z: return r->acc[2];
+  default:                         return 0;
+  }
+}
+
+static int configure(int type, int enable)
+{
+  return 1;
+}
+
+static int status(int type)
+{
+  return 1;
+}
+
+SENSORS_SENSOR(opt_3001_sensor, "OPT3001", opt_value, configure, status);
+SENSORS_SENSOR(mpu_9250_sensor, "MPU9250", mpu_value, configure, status);
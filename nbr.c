@@ -7,6 +7,8 @@
 #include <string.h>
 #include <stdio.h>
 #include "node-id.h"
+#include "evlog.h"
+#include "slot_sched.h"
 
 // Configures the wake-up timer for neighbour discovery 
 #define WAKE_TIME RTIMER_SECOND / 10
@@ -34,7 +36,7 @@ typedef struct {
 } data_packet_struct;
 
 
-static struct rtimer rt __attribute__((unused));
+static slot_sched_t sched;
 static struct pt pt;
 static data_packet_struct data_packet;
 unsigned long curr_timestamp;
@@ -50,31 +52,31 @@ void receive_packet_callback(const void *data, uint16_t len, const linkaddr_t *s
   if(len != sizeof(data_packet_struct)) return;
   static data_packet_struct pkt; memcpy(&pkt,data,len);
 
-  printf("RX seq %lu from %lu phase %u flags 0x%02X\n", pkt.seq, pkt.src_id, pkt.phase, pkt.flags);
+  EVLOG_DBG(EV_NBR_RX, pkt.seq, pkt.src_id, pkt.phase, pkt.flags);
 
   switch(mode) {
   case MODE_NORMAL:
       // detect other device -> go aggressive
       mode = MODE_AGGRESSIVE;
       aggressive_start_time = clock_time();
-      printf("MODE_NORMAL -> MODE_AGGRESSIVE\n");
+      EVLOG_INFO(EV_NBR_TO_AGGRESSIVE);
       break;
   case MODE_AGGRESSIVE:
       if(pkt.flags & FLAG_ACK) {
           mode = MODE_COMPLETE;
-          printf("ACK seen -> MODE_COMPLETE\n");
+          EVLOG_INFO(EV_NBR_ACK_SEEN);
       } else if(!ack_started) {
           // peer still aggressive - become ACK sender
           mode = MODE_ACK;
           ack_start_time = clock_time();
           ack_started = 1;
-          printf("Start ACK window\n");
+          EVLOG_INFO(EV_NBR_ACK_WINDOW);
       }
       break;
   case MODE_ACK:
       if(pkt.flags & FLAG_ACK) {
           mode = MODE_COMPLETE;
-          printf("Peer ACK -> MODE_COMPLETE\n");
+          EVLOG_INFO(EV_NBR_PEER_ACK);
       }
       break;
   default:
@@ -90,11 +92,11 @@ char sender_scheduler(struct rtimer *t, void *ptr) {
   PT_BEGIN(&pt);
 
   curr_timestamp = clock_time();
-  printf("Start clock %lu ticks, timestamp %3lu.%03lu\n", curr_timestamp, curr_timestamp / CLOCK_SECOND, ((curr_timestamp % CLOCK_SECOND) * 1000) / CLOCK_SECOND);
+  EVLOG_INFO(EV_NBR_START, curr_timestamp, curr_timestamp / CLOCK_SECOND, ((curr_timestamp % CLOCK_SECOND) * 1000) / CLOCK_SECOND);
 
   while(1) {
     if(mode == MODE_COMPLETE) {
-      printf("Discovery complete, stopping transmissions and entering sleep mode.\n");
+      EVLOG_INFO(EV_NBR_COMPLETE, sched.missed);
       NETSTACK_RADIO.off();
       PT_EXIT(&pt);
     }
@@ -117,12 +119,12 @@ char sender_scheduler(struct rtimer *t, void *ptr) {
       curr_timestamp = clock_time();
       data_packet.timestamp = curr_timestamp;
       
-      printf("Send seq# %lu  @ %8lu ticks   %3lu.%03lu, phase %d\n", data_packet.seq, curr_timestamp, curr_timestamp / CLOCK_SECOND, ((curr_timestamp % CLOCK_SECOND) * 1000) / CLOCK_SECOND, data_packet.phase);
+      EVLOG_DBG(EV_NBR_SEND, data_packet.seq, curr_timestamp, data_packet.phase);
       
       NETSTACK_NETWORK.output(&dest_addr);
       
       if(i != (NUM_SEND - 1)) {
-        rtimer_set(t, RTIMER_TIME(t) + WAKE_TIME, 1, sender_scheduler, ptr);
+        slot_sched_next(&sched, WAKE_TIME, (rtimer_callback_t)sender_scheduler, ptr);
         PT_YIELD(&pt);
       }
     }
@@ -135,23 +137,23 @@ char sender_scheduler(struct rtimer *t, void *ptr) {
       sleep_count = 1;
       if(current - aggressive_start_time >= 10 * CLOCK_SECOND) {
         mode = MODE_NORMAL;
-        printf("10s aggressive mode timeout -> MODE_NORMAL\n");
+        EVLOG_INFO(EV_NBR_AGGR_TIMEOUT);
       }
     } else if(mode == MODE_ACK) {
       sleep_count = 1;
       if(current - ack_start_time >= 2 * CLOCK_SECOND) {
         mode = MODE_COMPLETE;
         ack_started = 0;
-        printf("ACK window done -> MODE_COMPLETE\n");
+        EVLOG_INFO(EV_NBR_ACK_DONE);
       }
     } else if(mode == MODE_NORMAL) {
       sleep_count = LOW_SLEEP_COUNT;
     }
     
-    printf("Sleep for %d slots (mode %d)\n", sleep_count, mode);
+    EVLOG_DBG(EV_NBR_SLEEP, sleep_count, mode);
     for(i = 0; i < sleep_count; i++){
-      rtimer_set(t, RTIMER_TIME(t) + SLEEP_SLOT, 1,
-                 (rtimer_callback_t)sender_scheduler, ptr);
+      slot_sched_next(&sched, SLEEP_SLOT,
+                      (rtimer_callback_t)sender_scheduler, ptr);
       PT_YIELD(&pt);
     }
   }
@@ -162,6 +164,7 @@ char sender_scheduler(struct rtimer *t, void *ptr) {
 __attribute__((used))
 PROCESS_THREAD(nbr_discovery_process, ev, data) {
   PROCESS_BEGIN();
+  evlog_init();
   
   data_packet.src_id = node_id;
   data_packet.seq = 0;
@@ -173,7 +176,7 @@ PROCESS_THREAD(nbr_discovery_process, ev, data) {
   printf("CC2650 neighbour discovery\n");
   printf("Node %d will be sending packet of size %d Bytes\n", node_id, (int)sizeof(data_packet_struct));
   
-  rtimer_set(&rt, RTIMER_NOW() + (RTIMER_SECOND / 1000), 1, (rtimer_callback_t)sender_scheduler, NULL);
+  slot_sched_start(&sched, RTIMER_SECOND / 1000, (rtimer_callback_t)sender_scheduler, NULL);
   
   PROCESS_END();
 }
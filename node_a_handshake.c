@@ -14,55 +14,32 @@
 #include "net/linkaddr.h"
 #include <string.h>
 #include "node-id.h"
+#include "protocol.h"
+#include "slot_sched.h"
 
 PROCESS(process_rtimer, "RTimer");
 AUTOSTART_PROCESSES(&process_rtimer);
 
 #define SAMPLES 60 // No. of samples we are collecting
-#define CHUNK_SIZE 20 // Number of readings in each packet (chunk)
+#define CHUNK_SIZE PROTO_CHUNK_SIZE // Number of readings in each packet (chunk)
 #define SEND_CHUNK_INTERVAL (RTIMER_SECOND / 4) // Interval between sending chunks
 #define MAX_CHUNK_TRIES 20 // Max tries to send a chunk before giving up
 
 #define WAKE_TIME (RTIMER_SECOND / 10)   // Wake time for neighbour discovery
 #define SLEEP_SLOT (RTIMER_SECOND / 10)   // Sleep time between receiving
 
-// Packet types
-#define PKT_BEACON 0x01
-#define PKT_REQUEST 0x02
-#define PKT_DATA 0x03
-#define PKT_ACK 0x04
-#define PKT_REQ_ACK 0x05
-
-
-typedef struct __attribute__((packed)) {
-  uint8_t type;   // Packet type
-  uint16_t src_id;
-} req_pkt_t;
-
-typedef struct __attribute__((packed)) {
-  uint8_t type;
-  uint16_t src_id;
-  uint8_t seq;   // Chunk number
-} ack_pkt_t;
-
-typedef struct __attribute__((packed)) {
-  uint8_t type;
-  uint16_t src_id;
-  uint8_t seq;
-  int16_t payload[CHUNK_SIZE * 2]; // Light and motion data
-} data_pkt_t;
-
 static data_pkt_t data_packet;
 
 
 typedef enum { LINK_SEARCHING = 0, LINK_UP = 1 } link_state_t;
 static link_state_t link_state = LINK_SEARCHING;
 
-static struct rtimer rt;
+static slot_sched_t sched; // all rtimer steps run on this grid
 static rtimer_clock_t sampling_interval = RTIMER_SECOND; // Sampling interval for 1hz
 static int16_t light_readings[SAMPLES];
 static int16_t motion_readings[SAMPLES];
 static uint8_t sample_idx = 0;
+static uint8_t hist_head = 0; // Oldest reading once the rolling window has wrapped
 static int curr_chunk = 0;
 
 static int send_req_cycle = 0; 
@@ -89,13 +66,11 @@ static void init_mpu_reading(void){
   mpu_9250_sensor.configure(SENSORS_ACTIVE, MPU_9250_SENSOR_TYPE_ALL); 
 }
 
+// Rolling window as a ring: overwrite the oldest reading instead of shifting all 60
 static void enqueue(int16_t light, int16_t motion){
-  for (int i = 0; i < SAMPLES - 1; i++) {
-      light_readings[i] = light_readings[i + 1];
-      motion_readings[i] = motion_readings[i + 1];
-  }
-  light_readings[SAMPLES - 1] = light;
-  motion_readings[SAMPLES - 1] = motion;
+  light_readings[hist_head] = light;
+  motion_readings[hist_head] = motion;
+  hist_head = (hist_head + 1) % SAMPLES;
 }
 
 static int get_light_reading(void){
@@ -128,15 +103,15 @@ static void send_request(struct rtimer *t, void *ptr){
     enqueue(light, motion);
   }
 
-  req_pkt_t req = { PKT_REQUEST, node_id };
+  static req_pkt_t req;
   nullnet_buf = (uint8_t *)&req;
-  nullnet_len = sizeof(req);
+  nullnet_len = proto_build_req(&req, PKT_REQUEST, node_id);
   NETSTACK_NETWORK.output(NULL);
   printf("Sending Request Packet\n");
 
   NETSTACK_RADIO.on();
 
-  rtimer_set(t, RTIMER_NOW() + WAKE_TIME, 0, end_listening, NULL);
+  slot_sched_next(&sched, WAKE_TIME, end_listening, NULL);
 }
 
 static void end_listening(struct rtimer *t, void *ptr){
@@ -144,10 +119,10 @@ static void end_listening(struct rtimer *t, void *ptr){
 
   if(link_state == LINK_SEARCHING){
       // Didn't receive any REQ_ACK packets – sleep and schedule next send request
-      rtimer_set(t, RTIMER_NOW() + SLEEP_SLOT, 0, send_request, NULL);
+      slot_sched_next(&sched, SLEEP_SLOT, send_request, NULL);
   } else if(link_state == LINK_UP){
       // Discoverd a neighbour – start sending chunks
-      rtimer_set(t, RTIMER_NOW() + SEND_CHUNK_INTERVAL, 0, send_chunks, NULL);
+      slot_sched_next(&sched, SEND_CHUNK_INTERVAL, send_chunks, NULL);
   }
 }
 
@@ -158,25 +133,25 @@ static void get_readings(struct rtimer *t, void *ptr){
   sample_idx++;
 
   if(sample_idx < SAMPLES){
-    rtimer_set(&rt, RTIMER_NOW() + sampling_interval, 0, get_readings, NULL);
+    slot_sched_next(&sched, sampling_interval, get_readings, NULL);
   } else {
     curr_chunk = 0;
     link_state = LINK_SEARCHING;
     peer_set = 0;
     good_cnt = 0;
-    rtimer_set(&rt, RTIMER_NOW() + sampling_interval, 0, send_request, NULL);
+    slot_sched_next(&sched, sampling_interval, send_request, NULL);
   }
 }
 
 static void receive_cb(const void *data, uint16_t len, const linkaddr_t *src, const linkaddr_t *dest){
-  if(len == 0) {
+  const ack_pkt_t *ack = proto_ack_view(data, len);
+  if(ack == NULL) {
     return;
   }
-  uint8_t type = ((const uint8_t*)data)[0];
+  uint8_t type = proto_type(data, len);
 
   if(type == PKT_REQ_ACK) {
-    ack_pkt_t *ackp = (ack_pkt_t *)data;
-    uint16_t   sender_id = ackp->src_id;
+    uint16_t sender_id = ack->src_id;
 
     signed short rssi = (signed short)packetbuf_attr(PACKETBUF_ATTR_RSSI);
 
@@ -201,7 +176,6 @@ static void receive_cb(const void *data, uint16_t len, const linkaddr_t *src, co
         // first chunk will be scheduled by end_listening()
     }
   } else if(type == PKT_ACK) {
-    ack_pkt_t *ack = (ack_pkt_t *)data;
     uint8_t ackseq = ack->seq;
     signed short rssi = (signed short)packetbuf_attr(PACKETBUF_ATTR_RSSI);
 
@@ -218,6 +192,7 @@ static void receive_cb(const void *data, uint16_t len, const linkaddr_t *src, co
         memset(light_readings, 0, sizeof(light_readings));
         memset(motion_readings,0, sizeof(motion_readings));
         sample_idx = 0;
+        hist_head  = 0;
         peer_set   = 0;
         good_cnt   = 0;
         curr_chunk = -1;
@@ -240,23 +215,23 @@ static void send_chunks(struct rtimer *t, void *ptr) {
   last_sent_seq = curr_chunk;
   awaiting_ack = 1;
 
-  data_packet.type = PKT_DATA;
-  data_packet.src_id = node_id;
-  data_packet.seq = curr_chunk;
-  for(uint8_t i=0;i<CHUNK_SIZE;i++){
-    uint8_t idx = curr_chunk*CHUNK_SIZE + i;
-    data_packet.payload[2*i] = light_readings[idx];
-    data_packet.payload[2*i +1 ] = motion_readings[idx];
+  // Read the window oldest first, starting at the ring head
+  uint8_t off = curr_chunk*CHUNK_SIZE;
+  int16_t light[CHUNK_SIZE], motion[CHUNK_SIZE];
+  for(uint8_t i = 0; i < CHUNK_SIZE; i++) {
+    uint8_t idx = (hist_head + off + i) % SAMPLES;
+    light[i] = light_readings[idx];
+    motion[i] = motion_readings[idx];
   }
   nullnet_buf = (uint8_t*)&data_packet;
-  nullnet_len = sizeof(data_packet);
+  nullnet_len = proto_build_data(&data_packet, node_id, curr_chunk, light, motion);
   NETSTACK_NETWORK.output(&peer);
   curr_chunk_tries++;
 
 
   NETSTACK_RADIO.on();
 
-  rtimer_set(t, RTIMER_NOW() + WAKE_TIME, 0, listen_chunk_ack, NULL);
+  slot_sched_next(&sched, WAKE_TIME, listen_chunk_ack, NULL);
 }
 
 static void listen_chunk_ack(struct rtimer *t, void *ptr){
@@ -271,16 +246,16 @@ static void listen_chunk_ack(struct rtimer *t, void *ptr){
       link_state = LINK_SEARCHING;
       good_cnt = 0;
       total_rssi = 0;
-      rtimer_set(t, RTIMER_NOW() + SLEEP_SLOT, 0, send_request, NULL);
+      slot_sched_next(&sched, SLEEP_SLOT, send_request, NULL);
     } else {
-      rtimer_set(t, RTIMER_NOW() + SLEEP_SLOT, 0, send_chunks, NULL);
+      slot_sched_next(&sched, SLEEP_SLOT, send_chunks, NULL);
     }
   }else if(curr_chunk != -1){
-    rtimer_set(t, RTIMER_NOW() + SEND_CHUNK_INTERVAL, 0, send_chunks, NULL);
+    slot_sched_next(&sched, SEND_CHUNK_INTERVAL, send_chunks, NULL);
   } else {
     printf("Restarting reading cycle\n");
     link_state = LINK_SEARCHING;
-    rtimer_set(t, RTIMER_NOW() + sampling_interval, 0, get_readings, NULL);
+    slot_sched_next(&sched, sampling_interval, get_readings, NULL);
   }
 }
 
@@ -291,6 +266,6 @@ PROCESS_THREAD(process_rtimer, ev, data){
   init_mpu_reading();
   nullnet_set_input_callback(receive_cb);
 
-  rtimer_set(&rt, RTIMER_NOW() + sampling_interval, 0, get_readings, NULL);
+  slot_sched_start(&sched, sampling_interval, get_readings, NULL);
   PROCESS_END();
 }
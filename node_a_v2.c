@@ -4,20 +4,102 @@
  * Behaviour
  * ----------
  * – IDLE: only MPU‑9250 active for motion sensing.
- * – On |motion| ≥ MOTION_THRESHOLD, switch to COLLECTING.
- * – COLLECTING: sample light + motion at 1 Hz for 60 s (SAMPLES = 60).
- * – Store each 60‑second set in a circular buffer that holds MAX_SETS = 5.
- * – When buffer not empty, enter SENDING state:
- *      1. Transmit PKT_REQUEST every duty‑cycle until three consecutive
- *         PKT_REQ_ACK frames have RSSI ≥ RSSI_GOOD_THRESHOLD.
- *      2. Send three PKT_DATA chunks (20 readings each) with ACKs.
- * – After all chunks ACKed, dequeue the set and repeat if more data.
+ * – When |motion| departs from 1 g (MOTION_REST) by MOTION_THRESHOLD
+ *   or more, switch to COLLECTING.
+ * – COLLECTING: sample light + motion, SAMPLES = 60 per set.  With
+ *   ADAPTIVE_SAMPLING the rate follows motion variance (10 Hz / 1 Hz /
+ *   0.5 Hz) and each sample's time offset is stored and uploaded;
+ *   otherwise the rate is a fixed 1 Hz (60 s per set).
+ * – PRE_SAMPLES: while idle, the last readings are kept in a ring in the
+ *   first slots of the next free set; on a trigger the set keeps that
+ *   ring as its first PRE_SAMPLES samples (oldest at pre_start) and
+ *   fills the rest after the event, so nothing is shifted or copied.
+ * – Store each 60‑second set in a queue of MAX_SETS = 5 (setq.h), plus
+ *   the slot the next set is collected into, so an event is recorded
+ *   even while the queue is full or an upload is in progress – and an
+ *   upload may last the whole outage while Node B is away.  A full
+ *   queue then gives up a set by QUEUE_DROP (NODE_A_CONF_DROP): the
+ *   oldest (default), the new one (keep what is queued), or the one
+ *   with the least activity – the mean |motion| while collecting.
+ *   QUEUE_ORDER (NODE_A_CONF_ORDER) picks the next set to upload:
+ *   oldest first (default), newest first, or most active first.  Oldest
+ *   first turns newest first once the backlog is QUEUE_OUTAGE s old,
+ *   for the sets picked after that: the set being uploaded stays pinned
+ *   until it is delivered, so an outage‑long session keeps the oldest
+ *   set, and the current state goes next, before the rest of the
+ *   history.
+ * – When the queue is not empty, enter SENDING state:
+ *      1. Transmit PKT_REQUEST until three consecutive
+ *         PKT_REQ_ACK frames have RSSI ≥ RSSI_GOOD_THRESHOLD.  Retries
+ *         follow retry_ctl.h: fast at first, then exponential backoff
+ *         with jitter, within a per‑hour radio‑on budget; any reply,
+ *         heard beacon or new motion trigger resets the backoff, during
+ *         an upload too.
+ *      2. Send the set as PKT_RUN frames (20 readings each) with ACKs, or
+ *         with SUMMARY_UPLOAD a single PKT_SUMMARY holding per‑channel
+ *         features (feature.h) accumulated while collecting.
+ *         With PROTO_BLOCK_ACK the ready chunks go out as one burst
+ *         and Node B answers with a single PKT_BLOCK_ACK bitmap; only
+ *         the samples missing from it are sent again.  RUN_ADAPT sizes
+ *         the frames of each burst (5–20 samples) for the best expected
+ *         goodput at the frame loss Node B reports.
+ *         FEC_PARITY adds XOR parity frames to the first burst of a
+ *         set, 0–2 of them depending on that loss, so a frame lost on
+ *         a bad link is rebuilt without a resend.
+ *      3. The radio is switched off as soon as the awaited reply is in;
+ *         reply latency and timeouts per frame kind are logged with
+ *         each delivered set to tune WAKE_TIME (NODE_A_CONF_WAKE_TIME).
+ * – After all chunks ACKed, dequeue the set and go on with the next one
+ *   in the same session – the link has just carried a set, so no new
+ *   handshake.  BATCH_SETS (NODE_A_CONF_BATCH) holds uploads back until
+ *   that many sets are queued or the oldest has waited BATCH_MAX_AGE
+ *   (NODE_A_CONF_BATCH_AGE), so the handshake is paid once per batch.
+ *   At the end of each session the radio‑on time per delivered sample
+ *   (with its energy at RADIO_MW), handshakes per set and the time
+ *   sets waited from completion to delivery are logged, to tune K.
+ * – CONTACT_PREDICT (NODE_A_CONF_CONTACT): Node A learns at which times
+ *   of day Node B answers (contact.h) – a handshake that gets through
+ *   counts as a hit, CONTACT_TRIES unanswered requests in a row as a
+ *   miss.  A due upload is held while a better time of day comes
+ *   before the oldest set would have waited CONTACT_MAX_WAIT, and a
+ *   session that misses at a poor time stops instead of backing off
+ *   until then, so requests are not spent while Node B is out of reach.
+ * – STREAMING_UPLOAD: the handshake starts as soon as the first frame
+ *   of a set is collected and each further frame goes out once its
+ *   samples are in, while sampling carries on – a set reaches Node B
+ *   ~20 s after its first sample instead of 60 s plus the handshake.
+ * – RI_MODE (receiver‑initiated): no PKT_REQUEST at all.  Node B
+ *   (mains powered) beacons at the start of every listen window; Node A
+ *   listens RI_LISTEN every RI_INTERVAL and, on a beacon from the peer
+ *   with RSSI ≥ RSSI_GOOD_THRESHOLD, sends its chunks straight away
+ *   inside that window.  Needs node_b_v2 built with NODE_B_CONF_RI.
+ * – DISC_MODE (NODE_A_CONF_DISCOVERY): neighbour discovery (nbr.c) and
+ *   upload in one firmware.  Instead of polling with PKT_REQUEST the
+ *   tag broadcasts low‑duty rounds of DISC_SEND discovery beacons
+ *   flagged "set available", WAKE_TIME apart so one of them falls into
+ *   Node B's listen window, and listens after each.  Node B's answer
+ *   carries the RSSI it heard the beacon at and the time to its next
+ *   window: one answer ≥ RSSI_GOOD_THRESHOLD both ways takes the place
+ *   of three REQ_ACKs, its sender becomes the peer and the set goes
+ *   out straight in that rendezvous window.  Rounds are DISC_SLEEP
+ *   apart, or further once retry_ctl.h backs off.  Needs node_b_v2
+ *   built with NODE_B_CONF_DISCOVERY.
+ * – TDMA_MODE (NODE_A_CONF_TDMA): with Node B built with
+ *   NODE_B_CONF_TDMA the REQ_ACK grants a transfer slot.  Bursts then
+ *   go out only inside it, so tags that are ready at the same time do
+ *   not collide, and further sets skip the handshake while the slot
+ *   is held.  A burst that no longer fits waits for the slot's next
+ *   occurrence and sends its set from the start; a block ACK that
+ *   does not come gives the slot up for a new handshake.
+ * – A reading ≥ ALERT_THRESHOLD sends a PKT_ALERT at once, preempting
+ *   any upload in progress; it is repeated every ALERT_LISTEN until
+ *   PKT_ALERT_ACK or ALERT_TRIES are used up, then the upload resumes
+ *   with a fresh handshake.  One alert per excursion above threshold.
  */
 
  #include <stdio.h>
  #include <stdlib.h>
  #include <stdint.h>
- #include <math.h>
  #include <string.h>
  #include "contiki.h"
  #include "sys/rtimer.h"
@@ -25,183 +107,1040 @@
  #include "net/netstack.h"
  #include "net/packetbuf.h"
  #include "node-id.h"
- #include "board-peripherals.h"
+ #include "evlog.h"
+ #include "protocol.h"
+ #include "slot_sched.h"
+ #include "sensor_src.h"
+ #include "adapt_sampler.h"
+ #include "feature.h"
+ #include "retry_ctl.h"
+ #include "setq.h"
+ #include "contact.h"
  
  /* ------------ parameters ------------ */
  #define MOTION_THRESHOLD        1           /* centi‑g */
+ #define MOTION_REST             100         /* centi‑g, gravity alone */
  #define SAMPLES                 60          /* 60 s window           */
- #define CHUNK_SIZE              20          /* 3 chunks per set       */
- #define MAX_SETS                5           /* buffer capacity        */
+ #define MAX_SETS                5           /* queue capacity         */
  
- #define SAMPLE_INTERVAL         CLOCK_SECOND
+ #ifdef NODE_A_CONF_DROP
+ #define QUEUE_DROP              NODE_A_CONF_DROP
+ #else
+ #define QUEUE_DROP              SETQ_DROP_OLDEST
+ #endif
+ #ifdef NODE_A_CONF_ORDER
+ #define QUEUE_ORDER             NODE_A_CONF_ORDER
+ #else
+ #define QUEUE_ORDER             SETQ_ORDER_OLDEST
+ #endif
+ #ifdef NODE_A_CONF_OUTAGE
+ #define QUEUE_OUTAGE            NODE_A_CONF_OUTAGE
+ #else
+ #define QUEUE_OUTAGE            600         /* s, 0 = always oldest first */
+ #endif
+ #if MAX_SETS > SETQ_MAX
+ #error "MAX_SETS exceeds SETQ_MAX (SETQ_CONF_MAX)"
+ #endif
+ 
+ #define SAMPLE_INTERVAL         (CLOCK_SECOND / SENSOR_SRC_SPEEDUP)
+ #define FAST_INTERVAL           (SAMPLE_INTERVAL / 10)   /* 10 Hz  */
+ #define SLOW_INTERVAL           (SAMPLE_INTERVAL * 2)    /* 0.5 Hz */
+ 
+ #ifdef NODE_A_CONF_ADAPTIVE
+ #define ADAPTIVE_SAMPLING       NODE_A_CONF_ADAPTIVE
+ #else
+ #define ADAPTIVE_SAMPLING       1
+ #endif
+ 
+ /* 1: upload one PKT_SUMMARY per set and keep no raw samples,
+  * 0: upload the raw set */
+ #ifdef NODE_A_CONF_SUMMARY
+ #define SUMMARY_UPLOAD          NODE_A_CONF_SUMMARY
+ #else
+ #define SUMMARY_UPLOAD          0
+ #endif
+ 
+ /* pre‑trigger history kept in the set (raw upload only), 0 = off */
+ #if defined(NODE_A_CONF_PRE_SAMPLES) && !SUMMARY_UPLOAD
+ #define PRE_SAMPLES             NODE_A_CONF_PRE_SAMPLES
+ #elif !SUMMARY_UPLOAD
+ #define PRE_SAMPLES             10          /* 10 s at idle rate     */
+ #else
+ #define PRE_SAMPLES             0
+ #endif
+ #if PRE_SAMPLES >= SAMPLES
+ #error "NODE_A_CONF_PRE_SAMPLES must be smaller than SAMPLES"
+ #endif
+ /* upload progress is kept in slices of PROTO_SLICE samples (the block
+  * ACK granularity); a frame carries 1..RUN_SLICES consecutive slices */
+ #define SLICE                   PROTO_SLICE
+ #define SET_SLICES              (SUMMARY_UPLOAD ? 1 : SAMPLES / SLICE)
+ #define RUN_SLICES              (SUMMARY_UPLOAD ? 1 : PROTO_RUN_MAX / SLICE)
+ #if SAMPLES % PROTO_SLICE || SAMPLES / PROTO_SLICE > 16
+ #error "SAMPLES must be a multiple of PROTO_SLICE, at most 16 slices"
+ #endif
+ #define BLOCK_ACK               (PROTO_BLOCK_ACK && !SUMMARY_UPLOAD)
+ #define BURST_GAP               (RTIMER_SECOND / 100) /* chunks in a burst */
+ 
+ /* 1: follow a full burst with XOR parity frames (needs BLOCK_ACK) */
+ #if defined(NODE_A_CONF_FEC) && BLOCK_ACK
+ #define FEC_PARITY              NODE_A_CONF_FEC
+ #else
+ #define FEC_PARITY              BLOCK_ACK
+ #endif
+ #define FEC_LOSS_1              13          /* /256: ≥ 5 % → 1 parity  */
+ #define FEC_LOSS_2              51          /* /256: ≥ 20 % → 2 parity */
+ 
+ /* 1: pick the frame size per burst from the reported loss (needs
+  * BLOCK_ACK), 0: always RUN_SLICES */
+ #if defined(NODE_A_CONF_RUN_ADAPT) && BLOCK_ACK
+ #define RUN_ADAPT               NODE_A_CONF_RUN_ADAPT
+ #else
+ #define RUN_ADAPT               BLOCK_ACK
+ #endif
+ #define FRAME_OVERHEAD          31          /* PHY + MAC + run header, bytes */
+ #define REC_BYTES               (ADAPTIVE_SAMPLING ? sizeof(run_rec_ts_t) : \
+                                                     sizeof(run_rec_t))
+ 
+ /* 1: upload the set being collected chunk by chunk (raw upload only) */
+ #ifdef NODE_A_CONF_STREAMING
+ #define STREAMING_UPLOAD        NODE_A_CONF_STREAMING
+ #else
+ #define STREAMING_UPLOAD        0
+ #endif
+ #if STREAMING_UPLOAD && SUMMARY_UPLOAD
+ #error "NODE_A_CONF_STREAMING needs raw upload (NODE_A_CONF_SUMMARY=0)"
+ #endif
+ 
+ /* upload once BATCH_SETS sets are queued or the oldest has waited
+  * BATCH_MAX_AGE s; 1 = as soon as a set is complete */
+ #ifdef NODE_A_CONF_BATCH
+ #define BATCH_SETS              NODE_A_CONF_BATCH
+ #else
+ #define BATCH_SETS              1
+ #endif
+ #ifdef NODE_A_CONF_BATCH_AGE
+ #define BATCH_MAX_AGE           NODE_A_CONF_BATCH_AGE
+ #else
+ #define BATCH_MAX_AGE           300         /* s, below QUEUE_OUTAGE */
+ #endif
+ #if BATCH_SETS < 1 || BATCH_SETS > MAX_SETS
+ #error "NODE_A_CONF_BATCH must be 1 … MAX_SETS"
+ #endif
+ #if STREAMING_UPLOAD && BATCH_SETS > 1
+ #error "NODE_A_CONF_STREAMING uploads every set at once (NODE_A_CONF_BATCH=1)"
+ #endif
+ /* radio power for the energy estimate: CC2650 RX 6.1 mA / TX 9.1 mA at 3 V */
+ #ifdef NODE_A_CONF_RADIO_MW
+ #define RADIO_MW                NODE_A_CONF_RADIO_MW
+ #else
+ #define RADIO_MW                20
+ #endif
+ 
+ /* contact prediction: hold uploads for the times of day Node B has
+  * answered at, a set at most CONTACT_MAX_WAIT s */
+ #ifdef NODE_A_CONF_CONTACT
+ #define CONTACT_PREDICT         NODE_A_CONF_CONTACT
+ #else
+ #define CONTACT_PREDICT         0
+ #endif
+ #ifdef NODE_A_CONF_CONTACT_MIN
+ #define CONTACT_MIN_P           NODE_A_CONF_CONTACT_MIN
+ #else
+ #define CONTACT_MIN_P           64          /* /255, ~25 % hits      */
+ #endif
+ #ifdef NODE_A_CONF_CONTACT_WAIT
+ #define CONTACT_MAX_WAIT        NODE_A_CONF_CONTACT_WAIT
+ #else
+ #define CONTACT_MAX_WAIT        3600        /* s                     */
+ #endif
+ #define CONTACT_TRIES           RETRY_FAST_TRIES  /* unanswered = a miss */
+ #if CONTACT_PREDICT && STREAMING_UPLOAD
+ #error "NODE_A_CONF_CONTACT holds uploads, NODE_A_CONF_STREAMING sends at once"
+ #endif
+ 
+ #ifdef NODE_A_CONF_ALERT_THRESHOLD
+ #define ALERT_THRESHOLD         NODE_A_CONF_ALERT_THRESHOLD
+ #else
+ #define ALERT_THRESHOLD         300         /* centi‑g, ~3 g         */
+ #endif
+ #define ALERT_TRIES             10          /* retry budget per alert */
+ #define ALERT_LISTEN            (RTIMER_SECOND / 20)  /* wait for ALERT_ACK */
+ 
+ /* feature parameters: peak prominence, histogram origin, log2 bin width */
+ #define LIGHT_PEAK_DELTA        50          /* 0.5 lux               */
+ #define LIGHT_HIST_LO           0
+ #define LIGHT_HIST_SHIFT        12          /* ~41 lux bins          */
+ #define MOTION_PEAK_DELTA       5           /* centi‑g               */
+ #define MOTION_HIST_LO          64
+ #define MOTION_HIST_SHIFT       4           /* 16 centi‑g bins       */
  #define SEND_CHUNK_INTERVAL     (RTIMER_SECOND / 4)
  
+ /* reply timeout after a REQUEST / chunk; the radio goes off as soon
+  * as the reply is in, so this is only paid in full when it is lost */
+ #ifdef NODE_A_CONF_WAKE_TIME
+ #define WAKE_TIME               NODE_A_CONF_WAKE_TIME
+ #else
  #define WAKE_TIME               (RTIMER_SECOND / 10)  /* 100 ms listen  */
+ #endif
  #define SLEEP_SLOT              (RTIMER_SECOND / 10)  /* 100 ms sleep   */
  
+ #ifdef NODE_A_CONF_RI
+ #define RI_MODE                 NODE_A_CONF_RI
+ #else
+ #define RI_MODE                 0
+ #endif
+ #define RI_LISTEN               (RTIMER_SECOND / 4)   /* > one Node B cycle */
+ #define RI_INTERVAL             (RTIMER_SECOND * 2)
+ 
+ #if RI_MODE
+ #define REQ_COST_MS             ((uint16_t)(RI_LISTEN * 1000UL / RTIMER_SECOND))
+ #define CHUNK_GAP               (RTIMER_SECOND / 100) /* stay in B's window */
+ #else
+ #define REQ_COST_MS             ((uint16_t)(WAKE_TIME * 1000UL / RTIMER_SECOND))
+ #define CHUNK_GAP               (RTIMER_SECOND / 20)
+ #endif
+ 
  #define RSSI_GOOD_THRESHOLD    (-70)        /* three ≥ threshold → good link */
  
- /* ------------ packet types ------------ */
- #define PKT_BEACON   0x01
- #define PKT_REQUEST  0x02
- #define PKT_DATA     0x03
- #define PKT_ACK      0x04
- #define PKT_REQ_ACK  0x05
- 
- /* ------------ packet formats ------------ */
- typedef struct __attribute__((packed)) {
-   uint8_t  type;
-   uint16_t src_id;
- } req_pkt_t;               /* also beacon */
- 
- typedef struct __attribute__((packed)) {
-   uint8_t  type;
-   uint16_t src_id;
-   uint8_t  seq;
- } ack_pkt_t;               /* REQ_ACK or DATA_ACK */
- 
- typedef struct __attribute__((packed)) {
-   uint8_t  type;
-   uint16_t src_id;
-   uint8_t  seq;
-   int16_t  payload[CHUNK_SIZE * 2];   /* light, motion interleaved */
- } data_pkt_t;
- 
- /* ------------ sample‑set circular buffer ------------ */
+ #ifdef NODE_A_CONF_TDMA
+ #define TDMA_MODE               NODE_A_CONF_TDMA
+ #else
+ #define TDMA_MODE               0
+ #endif
+ #define TDMA_NONE               0            /* no slot granted */
+ #define TDMA_GUARD              MS_TICKS(PROTO_SLOT_GUARD_MS) /* into the slot */
+ #define TDMA_BURST              MS_TICKS(PROTO_SLOT_BURST_MS) /* + block ACK */
+ #define TDMA_SKIP_MAX           255          /* occurrences skipped at once */
+ #define TDMA_LEASE              (PROTO_SLOT_LEASE - 2) /* s, with margin  */
+ #if TDMA_MODE && (RI_MODE || STREAMING_UPLOAD)
+ #error "NODE_A_CONF_TDMA sends whole sets after a handshake (no RI, no streaming)"
+ #endif
+ #if TDMA_MODE && !PROTO_BLOCK_ACK
+ #error "NODE_A_CONF_TDMA needs PROTO_BLOCK_ACK"
+ #endif
+ 
+ #ifdef NODE_A_CONF_DISCOVERY
+ #define DISC_MODE               NODE_A_CONF_DISCOVERY
+ #else
+ #define DISC_MODE               0
+ #endif
+ #define DISC_SEND               2            /* beacons per round, as nbr.c */
+ #define DISC_SLEEP              (RTIMER_SECOND * 18 / 10)  /* between rounds */
+ #if DISC_MODE && (RI_MODE || TDMA_MODE)
+ #error "NODE_A_CONF_DISCOVERY has its own handshake (no RI, no TDMA)"
+ #endif
+ 
+ /* ------------ sample sets ------------ */
  typedef struct {
+ #if SUMMARY_UPLOAD
+   feat_summary_t f_light;
+   feat_summary_t f_motion;
+   uint16_t span;                /* PROTO_TICK_MS units */
+ #else
    int16_t light[SAMPLES];
    int16_t motion[SAMPLES];
+ #if ADAPTIVE_SAMPLING
+   uint16_t stamp[SAMPLES];      /* now_stamp() of each sample */
+ #endif
+ #if PRE_SAMPLES
+   uint8_t pre_start;            /* oldest slot of the pre‑trigger ring */
+ #endif
+ #endif
+   uint8_t id;                   /* set number */
+   uint16_t activity;            /* mean |motion| while collecting */
  } sample_set_t;
  
- static sample_set_t buffer[MAX_SETS];
- static uint8_t buf_head = 0;    /* dequeue index      */
- static uint8_t buf_tail = 0;    /* enqueue index      */
- static uint8_t buf_len  = 0;    /* how many sets      */
+ static sample_set_t buffer[MAX_SETS + 1];   /* slots handed out by queue */
+ static setq_t       queue;
  
- static inline uint8_t buf_empty(void){ return buf_len == 0; }
- static inline uint8_t buf_full (void){ return buf_len == MAX_SETS; }
+ #define COLLECTING              (&buffer[setq_spare(&queue)])
+ #define UPLOADING               (&buffer[queue.pinned])
+ 
+ #if PRE_SAMPLES
+ /* slot of the i‑th sample of a set: the first PRE_SAMPLES are a ring */
+ static inline uint8_t set_slot(const sample_set_t *set, uint8_t i)
+ {
+   return i < PRE_SAMPLES ? (set->pre_start + i) % PRE_SAMPLES : i;
+ }
+ #else
+ #define set_slot(set, i)        (i)
+ #endif
  
  /* ------------ runtime state ------------ */
- static enum { ST_IDLE = 0, ST_COLLECTING, ST_SENDING } state = ST_IDLE;
+ static enum { ST_IDLE = 0, ST_COLLECTING } state = ST_IDLE;
  static uint8_t  sample_idx   = 0;   /* 0‑59 within current set */
- static uint8_t  tx_seq       = 0;   /* 0,1,2 chunk counter     */
- static uint8_t  awaiting_ack = 0;
+ #if PRE_SAMPLES
+ static uint8_t  pre_head     = 0;   /* next ring slot in COLLECTING */
+ static uint8_t  pre_count    = 0;   /* readings in the ring        */
+ #endif
+ static uint8_t  uploading    = 0;   /* radio side busy with UPLOADING */
+ static uint8_t  tx_seq       = 0;   /* first slice of the frame in flight */
+ static uint8_t  tx_n         = 0;   /* slices in it                 */
+ static uint8_t  tx_wait      = 0;   /* next slice not collected yet */
+ static uint16_t tx_map       = 0;   /* BLOCK_ACK: slices Node B has  */
+ static uint8_t  run_slices   = RUN_SLICES;   /* frame size, this burst */
+ #if BLOCK_ACK
+ static uint8_t  burst_sent   = 0;   /* frames since the last block ACK */
+ static uint16_t loss_q8      = 0;   /* EWMA loss of a RUN_SLICES frame, /256 */
+ #endif
+ #if FEC_PARITY
+ static uint8_t  par_todo     = 0;   /* parity frames planned this burst */
+ static uint8_t  par_sent     = 0;
+ #endif
+ #if TDMA_MODE
+ static uint8_t        tdma_slot = TDMA_NONE;   /* granted slot */
+ static rtimer_clock_t tdma_next;   /* start of its current occurrence */
+ static rtimer_clock_t tdma_used;   /* occurrence of the last burst */
+ static rtimer_clock_t tdma_period;
+ static rtimer_clock_t tdma_len;
+ static unsigned long  tdma_seen;   /* clock_seconds() of Node B's last reply */
+ #endif
+ #if DISC_MODE
+ static uint8_t  disc_seq     = 0;   /* beacon number, echoed by Node B */
+ static uint8_t  disc_left    = 0;   /* beacons left in this round */
+ #endif
+ static uint8_t  awaiting_ack = 0;   /* RI_MODE: awaiting a beacon */
  static uint8_t  good_cnt     = 0;
+ static uint8_t  set_id       = 0;
+ static uint32_t act_sum      = 0;   /* |motion| of the set so far */
+ static uint8_t  act_n        = 0;
+ 
+ static uint8_t  alert_active = 0;   /* alert owns the radio       */
+ static uint8_t  alert_armed  = 1;   /* motion back below threshold */
+ static uint8_t  alert_left   = 0;   /* transmissions left         */
+ static uint8_t  alert_seq    = 0;
+ static int16_t  alert_motion = 0;
  
  static struct etimer sample_timer;
- static struct rtimer rt;
+ #if ADAPTIVE_SAMPLING
+ static adapt_sampler_t adapt;
+ #endif
+ #if SUMMARY_UPLOAD
+ static uint16_t   set_start;        /* now_stamp() of sample 0 */
+ static feat_acc_t acc_light, acc_motion;     /* running set features */
+ #endif
+ static slot_sched_t sched;       /* all radio slots run on this grid */
+ static retry_ctl_t  retry;       /* PKT_REQUEST backoff + energy budget */
+ static uint8_t      budget_out = 0;
+ 
+ /* reply latency per frame kind, for tuning WAKE_TIME */
+ enum { LAT_REQ = 0, LAT_DATA, LAT_KINDS };
+ typedef struct {
+   uint16_t       n;                /* replies */
+   uint16_t       timeouts;         /* windows that closed without one */
+   uint32_t       sum;              /* rtimer ticks */
+   rtimer_clock_t max;
+ } lat_stats_t;
+ static lat_stats_t    lat[LAT_KINDS];
+ static rtimer_clock_t tx_at;       /* when the awaited frame went out */
+ static uint8_t        tx_kind = LAT_KINDS;   /* LAT_KINDS: not timed */
+ static uint8_t        replied;
+ 
+ /* upload cost and delay, to tune BATCH_SETS */
+ static struct {
+   uint64_t      on_ticks;         /* radio on, rtimer ticks */
+   uint32_t      sets;             /* delivered */
+   uint32_t      sessions;         /* handshakes that led to data */
+   uint32_t      wait_sum;         /* s, set complete → delivered */
+   unsigned long wait_max;
+ } cost;
+ static rtimer_clock_t radio_at;    /* radio on since */
+ static uint8_t        radio_is_on;
+ 
+ #if CONTACT_PREDICT
+ static contact_t      contact;
+ static uint8_t        contact_tries;  /* unanswered requests in a row */
+ static unsigned long  contact_until;  /* uploads held until, s */
+ #endif
  
  /* peer (Node B) link‑layer address – adjust if needed */
  static linkaddr_t peer = { .u8 = { 0x02, 0x00 } };
  
- /* ------------ helpers ------------ */
- static int16_t read_motion(void){
-   int16_t ax = mpu_9250_sensor.value(MPU_9250_SENSOR_TYPE_ACC_X);
-   int16_t ay = mpu_9250_sensor.value(MPU_9250_SENSOR_TYPE_ACC_Y);
-   int16_t az = mpu_9250_sensor.value(MPU_9250_SENSOR_TYPE_ACC_Z);
-   float g = sqrtf((float)(ax*ax + ay*ay + az*az)) / 16384.0f;
-   return (int16_t)(g * 100);        /* centi‑g */
+ /* radio on / off with on‑time accounting */
+ static void radio_on(void)
+ {
+   NETSTACK_RADIO.on();
+   if(!radio_is_on) radio_at = RTIMER_NOW();
+   radio_is_on = 1;
+ }
+ 
+ static void radio_off(void)
+ {
+   NETSTACK_RADIO.off();
+   if(radio_is_on) cost.on_ticks += (rtimer_clock_t)(RTIMER_NOW() - radio_at);
+   radio_is_on = 0;
+ }
+ 
+ /* local clock in PROTO_TICK_MS units, wraps at 2^16 (differences only) */
+ static uint16_t now_stamp(void)
+ {
+   return (uint16_t)((uint64_t)clock_time() * 1000 * SENSOR_SRC_SPEEDUP
+                     / CLOCK_SECOND / PROTO_TICK_MS);
+ }
+ 
+ /* slices of the set to upload that can be sent; the queue pins that
+  * set on first use, until it is delivered */
+ static uint8_t slices_ready(void)
+ {
+   uint8_t slot = setq_pick(&queue);
+ #if STREAMING_UPLOAD
+   /* nothing queued: stream the set being collected */
+   if(slot == SETQ_NONE && state == ST_COLLECTING) {
+     slot = setq_spare(&queue);
+     setq_pin(&queue, slot);
+   }
+ #endif
+   if(slot == SETQ_NONE) return 0;
+   if(slot != setq_spare(&queue)) return SET_SLICES;
+   return state == ST_COLLECTING ? sample_idx / SLICE : 0;
+ }
+ 
+ static void lat_sent(uint8_t kind)
+ {
+   tx_at   = RTIMER_NOW();
+   tx_kind = kind;
+   replied = 0;
+ }
+ 
+ /* the awaited reply is in: account for it and stop listening */
+ static void lat_reply(void)
+ {
+   radio_off();
+   if(tx_kind >= LAT_KINDS || replied) return;
+   rtimer_clock_t d = RTIMER_NOW() - tx_at;
+   lat_stats_t *l = &lat[tx_kind];
+   l->n++;
+   l->sum += d;
+   if(d > l->max) l->max = d;
+   replied = 1;
+ }
+ 
+ #define LAT_US(ticks)           ((unsigned long)((uint64_t)(ticks) * 1000000 / RTIMER_SECOND))
+ 
+ static void lat_report(void)
+ {
+ #if EVLOG_LEVEL >= EVLOG_LEVEL_INFO
+   const lat_stats_t *r = &lat[LAT_REQ], *d = &lat[LAT_DATA];
+   EVLOG_INFO(EV_A_LAT_REQ, r->n, r->n ? LAT_US(r->sum / r->n) : 0,
+              LAT_US(r->max), r->timeouts);
+   EVLOG_INFO(EV_A_LAT_DATA, d->n, d->n ? LAT_US(d->sum / d->n) : 0,
+              LAT_US(d->max), d->timeouts);
+ #endif
+ }
+ 
+ /* end of an upload session: what a delivered sample cost so far */
+ static void cost_report(void)
+ {
+ #if EVLOG_LEVEL >= EVLOG_LEVEL_INFO
+   uint32_t samples = cost.sets * SAMPLES;
+   unsigned long us = samples ? LAT_US(cost.on_ticks / samples) : 0;
+   EVLOG_INFO(EV_A_COST, us, us * RADIO_MW / 1000, cost.sessions, cost.sets);
+   EVLOG_INFO(EV_A_DELAY, cost.sets ? cost.wait_sum / cost.sets : 0,
+              cost.wait_max, BATCH_SETS);
+ #endif
+ }
+ 
+ #if CONTACT_PREDICT
+ /* an attempt to reach Node B is over: a hit or a miss for this time
+  * of day */
+ static void contact_seen(uint8_t ok)
+ {
+   unsigned long now = clock_seconds();
+   contact_update(&contact, now, ok);
+   contact_tries = 0;
+   EVLOG_DBG(EV_A_CONTACT, ok, now % CONTACT_DAY / CONTACT_BIN_S,
+             contact_p(&contact, now));
+ }
+ 
+ /* hold uploads while a better time of day comes before the oldest set
+  * has waited CONTACT_MAX_WAIT */
+ static uint8_t contact_hold(void)
+ {
+   unsigned long now = clock_seconds(), age = setq_age(&queue), w;
+ 
+   if(now < contact_until) return 1;
+   if(age >= CONTACT_MAX_WAIT) return 0;
+   w = contact_wait(&contact, now, CONTACT_MIN_P, CONTACT_MAX_WAIT - age);
+   if(w == 0 || w == CONTACT_NEVER) return 0;
+   contact_until = now + w;
+   EVLOG_INFO(EV_A_CONTACT_HOLD, contact_p(&contact, now), w, queue.len);
+   return 1;
+ }
+ #else
+ #define contact_seen(ok)
+ #define contact_hold()          0
+ #endif
+ 
+ /* enough queued to be worth a handshake, or the oldest cannot wait */
+ static uint8_t upload_due(void)
+ {
+   if(STREAMING_UPLOAD || queue.len >= BATCH_SETS ||
+      setq_age(&queue) >= BATCH_MAX_AGE) {
+     return !contact_hold() && slices_ready() != 0;
+   }
+   return 0;
  }
  
  /* forward declarations of rtimer callbacks */
  static void rt_send_req(struct rtimer *t, void *ptr);
  static void rt_listen_end(struct rtimer *t, void *ptr);
  static void rt_send_chunk(struct rtimer *t, void *ptr);
+ #if FEC_PARITY
+ static void rt_send_parity(struct rtimer *t, void *ptr);
+ #endif
+ static void rt_send_alert(struct rtimer *t, void *ptr);
+ static void upload_start(rtimer_clock_t delay);
+ 
+ /* hand the radio back to the upload after an alert */
+ static void resume_upload(void)
+ {
+   if(!uploading) return;
+   tx_wait  = 0;
+   good_cnt = 0;
+   upload_start(SLEEP_SLOT);
+ }
+ 
+ #if BLOCK_ACK
+ /* first slice ≥ from that Node B has not confirmed, SET_SLICES if none */
+ static uint8_t next_missing(uint8_t from)
+ {
+   while(from < SET_SLICES && (tx_map & (1 << from))) from++;
+   return from;
+ }
+ #endif
+ 
+ /* slices in the frame starting at from: up to run_slices collected ones
+  * Node B does not have yet; 0 while streaming if the frame could still
+  * grow with samples to come */
+ static uint8_t frame_slices(uint8_t from)
+ {
+   uint8_t ready = slices_ready();
+   uint8_t n = 0;
+   while(n < run_slices && from + n < ready && !(tx_map & (1 << (from + n)))) {
+     n++;
+   }
+   if(n < run_slices && from + n == ready && ready < SET_SLICES) return 0;
+   return n;
+ }
+ 
+ #if RUN_ADAPT
+ /* frame size with the best expected goodput, taking the loss of a frame
+  * as proportional to its length (close enough below ~30 %) */
+ static uint8_t best_run(void)
+ {
+   uint8_t  best = 1;
+   uint32_t best_g = 0;
+   for(uint8_t r = 1; r <= RUN_SLICES; r++) {
+     uint32_t bytes = (uint32_t)r * SLICE * REC_BYTES;
+     uint32_t q = (uint32_t)loss_q8 * r / RUN_SLICES;
+     uint32_t g = bytes * (256 - (q > 256 ? 256 : q)) / (bytes + FRAME_OVERHEAD);
+     if(g > best_g) { best_g = g; best = r; }
+   }
+   return best;
+ }
+ #endif
+ 
+ #define MS_TICKS(ms)            ((rtimer_clock_t)((uint32_t)(ms) * RTIMER_SECOND / 1000))
+ 
+ #if TDMA_MODE
+ /* Node B renews the lease with every frame of ours it hears */
+ static uint8_t tdma_held(void)
+ {
+   if(tdma_slot != TDMA_NONE && clock_seconds() - tdma_seen >= TDMA_LEASE) {
+     tdma_slot = TDMA_NONE;
+   }
+   return tdma_slot != TDMA_NONE;
+ }
+ 
+ /* delay ≥ want that puts the next burst inside our slot.  In another
+  * occurrence than the last burst the set starts over: Node B drops a
+  * half‑received set when another tag's slot comes in between. */
+ static rtimer_clock_t tdma_delay(rtimer_clock_t want)
+ {
+   rtimer_clock_t now = RTIMER_NOW();
+   rtimer_clock_t at  = now + want;
+   uint16_t skip = 0;
+ 
+   if(!tdma_held()) return want;
+   while(!RTIMER_CLOCK_LT(at, tdma_next + tdma_len - TDMA_BURST)) {
+     if(++skip > TDMA_SKIP_MAX) {
+       EVLOG_WARN(EV_A_SLOT_STALE, tdma_slot, skip);
+       tdma_slot = TDMA_NONE;        /* grid lost: contend, Node B re‑grants */
+       return want;
+     }
+     tdma_next += tdma_period;
+   }
+   if(tdma_next != tdma_used) {
+     tdma_used = tdma_next;
+     tx_map    = 0;
+   }
+   if(RTIMER_CLOCK_LT(at, tdma_next + TDMA_GUARD)) {
+     return tdma_next + TDMA_GUARD - now;
+   }
+   return want;
+ }
+ #else
+ #define tdma_delay(want)        (want)
+ #endif
+ 
+ /* link is up: send the frame at tx_seq (BLOCK_ACK: the first slice still
+  * missing), or wait for it to be collected */
+ static void start_chunks(rtimer_clock_t delay)
+ {
+   delay = tdma_delay(delay);
+ #if BLOCK_ACK
+   tx_seq = next_missing(0);
+   burst_sent = 0;
+ #endif
+ #if RUN_ADAPT
+   if(best_run() != run_slices) {
+     run_slices = best_run();
+     EVLOG_DBG(EV_A_RUN_SIZE, run_slices * SLICE, loss_q8);
+   }
+ #endif
+ #if FEC_PARITY
+   /* parity only with the first burst of a complete set: later bursts
+    * resend little and streamed frames go out one at a time */
+   uint16_t q = (uint32_t)loss_q8 * run_slices / RUN_SLICES;
+   par_sent = 0;
+   par_todo = 0;
+   if(tx_map == 0 && slices_ready() == SET_SLICES &&
+      SET_SLICES % run_slices == 0) {
+     par_todo = q >= FEC_LOSS_2 ? 2 : q >= FEC_LOSS_1 ? 1 : 0;
+   }
+ #endif
+   tx_n = frame_slices(tx_seq);
+   if(tx_n) {
+     slot_sched_start(&sched, delay, rt_send_chunk, NULL);
+   } else {
+     tx_wait = 1;                    /* streaming: resumed by the process */
+     EVLOG_DBG(EV_A_STREAM_WAIT, tx_seq);
+   }
+ }
+ 
+ /* open an upload session: handshake, or straight into a held slot */
+ static void upload_start(rtimer_clock_t delay)
+ {
+ #if TDMA_MODE
+   if(tdma_held()) {
+     awaiting_ack = 0;
+     tx_seq = 0;
+     start_chunks(delay);
+     return;
+   }
+ #endif
+   slot_sched_start(&sched, delay, rt_send_req, NULL);
+ }
+ 
+ /* UPLOADING acknowledged in full: free it, go on with the next set */
+ static void set_delivered(void)
+ {
+   unsigned long waited = clock_seconds() - queue.since[queue.pinned];
+   cost.sets++;
+   cost.wait_sum += waited;
+   if(waited > cost.wait_max) cost.wait_max = waited;
+   setq_done(&queue);
+   tx_seq = 0;
+   tx_map = 0;
+   EVLOG_INFO(EV_A_UPLOAD_DONE, clock_seconds(), queue.len, sched.missed);
+   lat_report();
+ 
+   /* more waiting? */
+   if(slices_ready()) {
+ #if RI_MODE
+     good_cnt = 0;
+     upload_start(RTIMER_SECOND / 5);  /* wait for Node B's next window */
+ #else
+     start_chunks(CHUNK_GAP);          /* same session, link still good */
+ #endif
+   } else {
+     uploading = 0;
+     cost_report();
+   }
+ }
  
  /* ------------ Nullnet input ------------ */
  static void input_callback(const void *data, uint16_t len,
                             const linkaddr_t *src, const linkaddr_t *dest)
  {
-   if(len == 0) return;
-   uint8_t type = ((uint8_t *)data)[0];
+ #if DISC_MODE
+   const disc_pkt_t *disc = proto_disc_view(data, len);
+   if(disc != NULL) {
+     int16_t rssi = (int16_t)packetbuf_attr(PACKETBUF_ATTR_RSSI);
+     if(!(disc->flags & PROTO_DISC_ACK) || disc->seq != disc_seq ||
+        !awaiting_ack || alert_active) {
+       return;                       /* another tag's beacon, a late answer */
+     }
+     retry_reset(&retry);
+     lat_reply();
+ #if CONTACT_PREDICT
+     contact_tries = 0;
+ #endif
+     if(rssi < RSSI_GOOD_THRESHOLD || disc->rssi < RSSI_GOOD_THRESHOLD ||
+        disc->wait_ms == 0) {
+       EVLOG_DBG(EV_A_DISC_WEAK, rssi, disc->rssi);
+       return;                       /* the round goes on */
+     }
+     /* link good both ways: the set goes out at the rendezvous */
+     linkaddr_copy(&peer, src);
+     awaiting_ack = 0;
+     disc_left    = 0;
+     cost.sessions++;
+     contact_seen(1);
+     EVLOG_DBG(EV_A_DISC, disc->src_id, rssi, disc->rssi, disc->wait_ms);
+     tx_seq = 0;
+     start_chunks(MS_TICKS(disc->wait_ms) + SLOT_SCHED_GUARD);
+     return;
+   }
+ #endif
+   if(proto_type(data, len) == PKT_BEACON && proto_req_view(data, len)) {
+     retry_reset(&retry);            /* a peer is around */
+ #if RI_MODE
+     int16_t rssi = (int16_t)packetbuf_attr(PACKETBUF_ATTR_RSSI);
+     if(awaiting_ack && !alert_active && linkaddr_cmp(src, &peer) &&
+        rssi >= RSSI_GOOD_THRESHOLD) {
+       /* Node B is listening right now: transmit inside its window */
+       awaiting_ack = 0;
+       cost.sessions++;
+       contact_seen(1);
+       EVLOG_DBG(EV_A_RI_BEACON, rssi);
+       start_chunks(SLOT_SCHED_GUARD);
+     }
+ #endif
+     return;
+   }
+ 
+ #if BLOCK_ACK
+   const block_ack_pkt_t *back = proto_block_ack_view(data, len);
+   if(back != NULL) {
+     retry_reset(&retry);
+     if(alert_active || !uploading) return;
+     lat_reply();
+     awaiting_ack = 0;
+     tx_map |= back->map;
+ #if TDMA_MODE
+     tdma_seen = clock_seconds();
+ #endif
+     if(burst_sent) {
+       /* heard < sent: frames lost on the way; scaled to a RUN_SLICES
+        * frame, it sets the frame size and the parity level */
+       uint8_t  lost = burst_sent > back->heard ? burst_sent - back->heard : 0;
+       uint16_t q = (uint16_t)lost * 256 * RUN_SLICES / (burst_sent * run_slices);
+       loss_q8 = loss_q8 - loss_q8 / 8 + (q > 256 ? 256 : q) / 8;
+     }
+     EVLOG_DBG(EV_A_BLOCK_ACK, back->map, back->heard, burst_sent);
+ 
+     if(next_missing(0) >= SET_SLICES) {
+       set_delivered();
+     } else {
+       start_chunks(CHUNK_GAP);      /* resend what the bitmap lacks */
+     }
+     return;
+   }
+ #endif
+ 
+   const ack_pkt_t *ack = proto_ack_view(data, len);
+   if(ack == NULL) return;
+   uint8_t type = proto_type(data, len);
+   retry_reset(&retry);
+ 
+   if(type == PKT_ALERT_ACK) {
+     if(!alert_active || ack->seq != alert_seq) return;
+     alert_active = 0;
+     radio_off();
+     EVLOG_INFO(EV_A_ALERT_ACKED, alert_seq, ALERT_TRIES - alert_left);
+     resume_upload();
+     return;
+   }
+   if(alert_active) return;          /* late bulk reply, upload restarts */
  
    if(type == PKT_REQ_ACK) {
-     /* handshake ACK */
+     /* handshake ACK; below three good ones the next REQUEST still goes
+      * out on the rt_listen_end grid, only the radio is off meanwhile */
+     lat_reply();
      int16_t rssi = (int16_t)packetbuf_attr(PACKETBUF_ATTR_RSSI);
      if(rssi >= RSSI_GOOD_THRESHOLD) good_cnt++; else good_cnt = 0;
-     awaiting_ack = 0;
+ #if CONTACT_PREDICT
+     contact_tries = 0;              /* in reach, if not yet good */
+ #endif
+ #if TDMA_MODE
+     /* a plain REQ_ACK: Node B has no slot for us, contend as before */
+     const slot_ack_pkt_t *sack = proto_slot_ack_view(data, len);
+     tdma_slot = sack != NULL ? sack->slot : TDMA_NONE;
+     if(sack != NULL) {
+       tdma_next   = RTIMER_NOW() + MS_TICKS(sack->wait_ms);
+       tdma_period = MS_TICKS(sack->period_ms);
+       tdma_len    = MS_TICKS(sack->len_ms);
+       tdma_seen   = clock_seconds();
+     }
+ #endif
  
      if(good_cnt >= 3) {
        /* link good – start first data chunk */
+       awaiting_ack = 0;
+       cost.sessions++;
+       contact_seen(1);
+ #if TDMA_MODE
+       EVLOG_DBG(EV_A_SLOT, tdma_slot, sack != NULL ? sack->wait_ms : 0,
+                 sack != NULL ? sack->period_ms : 0);
+ #endif
        tx_seq = 0;
-       rtimer_set(&rt, RTIMER_NOW() + RTIMER_SECOND / 20, 0,
-                  rt_send_chunk, NULL);
+       start_chunks(RTIMER_SECOND / 20);
      }
  
    } else if(type == PKT_ACK) {
      /* data chunk ack */
+     lat_reply();
      awaiting_ack = 0;
-     tx_seq++;
+     tx_seq += tx_n;
+     tx_n = tx_seq < SET_SLICES ? frame_slices(tx_seq) : 0;
  
-     if(tx_seq < 3) {
-       /* send next chunk */
-       rtimer_set(&rt, RTIMER_NOW() + RTIMER_SECOND / 20, 0,
-                  rt_send_chunk, NULL);
+     if(tx_seq >= SET_SLICES) {
+       set_delivered();
+     } else if(tx_n) {
+       /* send next frame */
+       slot_sched_start(&sched, CHUNK_GAP, rt_send_chunk, NULL);
      } else {
-       /* set delivered */
-       buf_head = (buf_head + 1) % MAX_SETS;
-       buf_len--;
-       printf("%lu Upload complete – buffer=%u\n", clock_seconds(), buf_len);
- 
-       /* more waiting? */
-       if(!buf_empty()) {
-         good_cnt = 0;
-         rtimer_set(&rt, RTIMER_NOW() + RTIMER_SECOND / 5, 0,
-                    rt_send_req, NULL);
-       } else {
-         state = ST_IDLE;
-       }
+       /* streaming: resumed from the process once collected */
+       tx_wait = 1;
+       EVLOG_DBG(EV_A_STREAM_WAIT, tx_seq);
      }
    }
  }
  
- /* ------------ rtimer: send PKT_REQUEST ------------ */
+ /* ------------ rtimer: send PKT_REQUEST (RI_MODE: listen) ------------ */
  static void rt_send_req(struct rtimer *t, void *ptr)
  {
-   if(buf_empty()) { state = ST_IDLE; return; }
+   if(!slices_ready()) { uploading = 0; return; }
  
-   req_pkt_t req = { PKT_REQUEST, node_id };
+   if(!retry_take(&retry, REQ_COST_MS)) {
+     /* hourly budget spent: stay silent, look again later */
+     if(!budget_out) EVLOG_WARN(EV_A_BUDGET_OUT, clock_seconds());
+     budget_out = 1;
+     slot_sched_next(&sched, RETRY_MAX, rt_send_req, NULL);
+     return;
+   }
+   budget_out = 0;
+ 
+ #if DISC_MODE
+   /* discovery round: DISC_SEND beacons WAKE_TIME apart, each with a
+    * listen for Node B's answer */
+   static disc_pkt_t beacon;
+   if(disc_left == 0) disc_left = DISC_SEND;
+   disc_left--;
+   disc_seq++;
+   nullnet_buf = (uint8_t *)&beacon;
+   nullnet_len = proto_build_disc(&beacon, node_id, disc_seq, PROTO_DISC_SET,
+                                  0, 0);
+   radio_on();
+   NETSTACK_NETWORK.output(NULL);
+   awaiting_ack = 1;
+   lat_sent(LAT_REQ);
+   EVLOG_DBG(EV_A_DISC_TX, disc_seq, disc_left);
+   slot_sched_next(&sched, WAKE_TIME, rt_listen_end, NULL);
+   return;
+ #endif
+ 
+ #if RI_MODE
+   /* receiver‑initiated: listen for Node B's beacon instead */
+   radio_on();
+   awaiting_ack = 1;
+   tx_kind = LAT_KINDS;              /* a beacon is not a reply */
+   EVLOG_DBG(EV_A_RI_LISTEN);
+   slot_sched_next(&sched, RI_LISTEN, rt_listen_end, NULL);
+   return;
+ #endif
+ 
+   static req_pkt_t req;
    nullnet_buf = (uint8_t *)&req;
-   nullnet_len = sizeof(req);
-   NETSTACK_RADIO.on();
+   nullnet_len = proto_build_req(&req, PKT_REQUEST, node_id);
+   radio_on();
    NETSTACK_NETWORK.output(&peer);
    awaiting_ack = 1;
+   lat_sent(LAT_REQ);
+   EVLOG_DBG(EV_A_REQ_TX, good_cnt);
  
    /* stay awake WAKE_TIME to wait for ACK */
-   rtimer_set(&rt, RTIMER_NOW() + WAKE_TIME, 0, rt_listen_end, NULL);
+   slot_sched_next(&sched, WAKE_TIME, rt_listen_end, NULL);
  }
  
  /* ------------ rtimer: radio off / retry if no ACK ------------ */
  static void rt_listen_end(struct rtimer *t, void *ptr)
  {
-   NETSTACK_RADIO.off();
+   radio_off();
+   if(awaiting_ack && !replied && tx_kind < LAT_KINDS) {
+     lat[tx_kind].timeouts++;
+   }
+ #if TDMA_MODE
+   if(awaiting_ack && tx_kind == LAT_DATA && tdma_slot != TDMA_NONE) {
+     EVLOG_WARN(EV_A_SLOT_LOST, tdma_slot);
+     tdma_slot = TDMA_NONE;          /* handshake again, Node B re‑grants */
+   }
+ #endif
    if(awaiting_ack) {
-     /* no ACK: sleep a slot then resend request */
-     rtimer_set(&rt, RTIMER_NOW() + SLEEP_SLOT, 0, rt_send_req, NULL);
+ #if DISC_MODE
+     if(disc_left) {
+       rt_send_req(t, ptr);          /* the round's next beacon */
+       return;
+     }
+ #endif
+ #if CONTACT_PREDICT
+     if(tx_kind != LAT_DATA && ++contact_tries >= CONTACT_TRIES) {
+       contact_seen(0);
+       if(contact_hold()) {
+         /* out of reach at a poor time: the process retries later */
+         awaiting_ack = 0;
+         uploading    = 0;
+         return;
+       }
+     }
+ #endif
+     /* no ACK: back off, then resend request */
+ #if DISC_MODE
+     rtimer_clock_t gap = retry_backoff(&retry);
+     slot_sched_next(&sched, gap < DISC_SLEEP ? DISC_SLEEP : gap,
+                     rt_send_req, NULL);
+ #else
+     slot_sched_next(&sched, RI_MODE ? RI_INTERVAL : retry_backoff(&retry),
+                     rt_send_req, NULL);
+ #endif
    }
  }
  
+ /* ------------ data frames ------------ */
+ #if !SUMMARY_UPLOAD
+ /* frame slices first … first+n−1 of UPLOADING, returns the length */
+ static uint16_t build_run(uint8_t first, uint8_t n, run_pkt_t *pkt)
+ {
+   const sample_set_t *set = UPLOADING;
+   uint8_t off = first * SLICE;
+   uint8_t cnt = n * SLICE;
+   const int16_t  *light  = &set->light[off];
+   const int16_t  *motion = &set->motion[off];
+ #if ADAPTIVE_SAMPLING
+   const uint16_t *stamp  = &set->stamp[off];
+   uint16_t t_prev = set->stamp[set_slot(set, off ? off - 1 : 0)];
+ #else
+   const uint16_t *stamp  = NULL;
+   uint16_t t_prev = 0;
+ #endif
+ #if PRE_SAMPLES
+   if(off < PRE_SAMPLES && set->pre_start != 0) {
+     /* run overlaps a wrapped pre‑trigger ring: gather it in order */
+     static int16_t  g_light[PROTO_RUN_MAX], g_motion[PROTO_RUN_MAX];
+ #if ADAPTIVE_SAMPLING
+     static uint16_t g_stamp[PROTO_RUN_MAX];
+     stamp = g_stamp;
+ #endif
+     for(uint8_t i = 0; i < cnt; i++) {
+       uint8_t k = set_slot(set, off + i);
+       g_light[i]  = set->light[k];
+       g_motion[i] = set->motion[k];
+ #if ADAPTIVE_SAMPLING
+       g_stamp[i]  = set->stamp[k];
+ #endif
+     }
+     light  = g_light;
+     motion = g_motion;
+   }
+ #endif
+   return proto_build_run(pkt, node_id, off, cnt, light, motion, stamp, t_prev);
+ }
+ #endif /* !SUMMARY_UPLOAD */
+ 
+ /* a frame of the current burst is out: next missing run, then the
+  * parity frames, then one listen for the reply to all of them */
+ static void burst_next(void)
+ {
+ #if BLOCK_ACK
+   burst_sent++;
+   uint8_t nxt = next_missing(tx_seq + tx_n);
+   uint8_t n   = nxt < SET_SLICES ? frame_slices(nxt) : 0;
+   if(n) {
+     tx_seq = nxt;
+     tx_n   = n;
+     slot_sched_next(&sched, BURST_GAP, rt_send_chunk, NULL);
+     return;
+   }
+ #endif
+ #if FEC_PARITY
+   if(par_sent < par_todo) {
+     slot_sched_next(&sched, BURST_GAP, rt_send_parity, NULL);
+     return;
+   }
+ #endif
+   awaiting_ack = 1;
+   lat_sent(LAT_DATA);
+   slot_sched_next(&sched, WAKE_TIME, rt_listen_end, NULL);
+ }
+ 
  /* ------------ rtimer: send data chunk ------------ */
  static void rt_send_chunk(struct rtimer *t, void *ptr)
  {
-   data_pkt_t pkt;
-   pkt.type   = PKT_DATA;
-   pkt.src_id = node_id;
-   pkt.seq    = tx_seq;
- 
-   const sample_set_t *set = &buffer[buf_head];
-   for(uint8_t i = 0; i < CHUNK_SIZE; i++) {
-     pkt.payload[2*i]     = set->light[tx_seq * CHUNK_SIZE + i];
-     pkt.payload[2*i + 1] = set->motion[tx_seq * CHUNK_SIZE + i];
+ #if SUMMARY_UPLOAD
+   const sample_set_t *set = UPLOADING;
+   static summary_pkt_t pkt;
+   nullnet_buf = (uint8_t *)&pkt;
+   nullnet_len = proto_build_summary(&pkt, node_id, set->id, SAMPLES,
+                                     set->span, &set->f_light,
+                                     &set->f_motion);
+ #else
+   static run_pkt_t pkt;
+   nullnet_buf = (uint8_t *)&pkt;
+   nullnet_len = build_run(tx_seq, tx_n, &pkt);
+ #endif
+   radio_on();
+   NETSTACK_NETWORK.output(&peer);
+   burst_next();
+ }
+ 
+ #if FEC_PARITY
+ /* ------------ rtimer: send parity frame ------------ */
+ static void rt_send_parity(struct rtimer *t, void *ptr)
+ {
+   static run_pkt_t pkt;
+   static run_pkt_t scratch;
+   uint8_t group = PROTO_PARITY_GROUP(par_sent, par_todo);
+ 
+   /* parity k of L covers the frames c with c % L == k, so two parity
+    * frames repair one loss among the even and one among the odd frames */
+   nullnet_buf = (uint8_t *)&pkt;
+   nullnet_len = proto_build_parity(&pkt, node_id, group, run_slices * SLICE,
+                                    ADAPTIVE_SAMPLING);
+   for(uint8_t c = par_sent; c < SET_SLICES / run_slices; c += par_todo) {
+     proto_parity_add(&pkt, &scratch,
+                      build_run(c * run_slices, run_slices, &scratch));
+   }
+   radio_on();
+   NETSTACK_NETWORK.output(&peer);
+   EVLOG_DBG(EV_A_PARITY_TX, group, run_slices * SLICE, loss_q8);
+   par_sent++;
+   burst_next();
+ }
+ #endif
+ 
+ /* ------------ rtimer: priority alert ------------ */
+ static void rt_send_alert(struct rtimer *t, void *ptr)
+ {
+   if(!alert_active) return;                    /* acked meanwhile */
+   if(alert_left == 0) {
+     radio_off();
+     alert_active = 0;
+     EVLOG_WARN(EV_A_ALERT_LOST, alert_seq);
+     resume_upload();
+     return;
    }
  
+   static alert_pkt_t pkt;
    nullnet_buf = (uint8_t *)&pkt;
-   nullnet_len = sizeof(pkt);
-   NETSTACK_RADIO.on();
+   nullnet_len = proto_build_alert(&pkt, node_id, alert_seq, alert_motion);
+   radio_on();
    NETSTACK_NETWORK.output(&peer);
-   awaiting_ack = 1;
+   alert_left--;
  
-   rtimer_set(&rt, RTIMER_NOW() + WAKE_TIME, 0, rt_listen_end, NULL);
+   /* radio stays on: listen for the ACK until the next attempt */
+   slot_sched_next(&sched, ALERT_LISTEN, rt_send_alert, NULL);
  }
  
  /* ------------ Contiki process ------------ */
@@ -212,9 +1151,14 @@
  {
    PROCESS_BEGIN();
  
+   evlog_init();
+   retry_init(&retry);
+ #if CONTACT_PREDICT
+   contact_init(&contact);
+ #endif
+   setq_init(&queue, MAX_SETS, QUEUE_DROP, QUEUE_ORDER, QUEUE_OUTAGE);
    nullnet_set_input_callback(input_callback);
-   SENSORS_ACTIVATE(mpu_9250_sensor);
-   SENSORS_ACTIVATE(opt_3001_sensor);
+   sensor_src_init();
  
    etimer_set(&sample_timer, SAMPLE_INTERVAL);
  
@@ -223,39 +1167,127 @@
  
      if(ev == PROCESS_EVENT_TIMER && data == &sample_timer) {
  
-       int16_t motion = read_motion();
+       sensor_src_tick();
+       int16_t motion = sensor_src_motion();
+ 
+       clock_time_t next = SAMPLE_INTERVAL;
+ 
+       if(motion < ALERT_THRESHOLD) {
+         alert_armed = 1;
+       } else if(alert_armed && !alert_active) {
+         /* takes over the slot grid, the upload is resumed afterwards */
+         alert_armed  = 0;
+         alert_active = 1;
+         alert_left   = ALERT_TRIES;
+         alert_motion = motion;
+         alert_seq++;
+         EVLOG_WARN(EV_A_ALERT, clock_seconds(), motion);
+         slot_sched_start(&sched, SLOT_SCHED_GUARD, rt_send_alert, NULL);
+       }
  
        if(state == ST_IDLE) {
-         if(abs(motion) >= MOTION_THRESHOLD && !buf_full()) {
-           printf("%lu Motion detected - start collecting\n", clock_seconds());
+ #if PRE_SAMPLES
+         {
+           /* O(1) history: overwrite the oldest ring slot */
+           sample_set_t *set = COLLECTING;
+           set->light[pre_head]  = sensor_src_light();
+           set->motion[pre_head] = motion;
+ #if ADAPTIVE_SAMPLING
+           set->stamp[pre_head]  = now_stamp();
+ #endif
+           pre_head = (pre_head + 1) % PRE_SAMPLES;
+           if(pre_count < PRE_SAMPLES) pre_count++;
+         }
+ #endif
+         /* collected into the spare slot, an upload in progress or not:
+          * a full queue is for the drop policy to handle */
+         if(abs(motion - MOTION_REST) >= MOTION_THRESHOLD) {
+           EVLOG_INFO(EV_A_MOTION, clock_seconds());
+           retry_reset(&retry);          /* new activity: fast retries again */
            sample_idx = 0;
+           act_sum    = 0;
+           act_n      = 0;
+ #if PRE_SAMPLES
+           /* the ring (ending with this reading) becomes the set's head;
+            * an unwrapped ring is already in order from slot 0 */
+           COLLECTING->pre_start = pre_count < PRE_SAMPLES ? 0 : pre_head;
+           sample_idx = pre_count;
+ #endif
            state = ST_COLLECTING;
+ #if SUMMARY_UPLOAD
+           feat_reset(&acc_light, LIGHT_PEAK_DELTA,
+                      LIGHT_HIST_LO, LIGHT_HIST_SHIFT);
+           feat_reset(&acc_motion, MOTION_PEAK_DELTA,
+                      MOTION_HIST_LO, MOTION_HIST_SHIFT);
+ #endif
+ #if ADAPTIVE_SAMPLING
+           adapt_reset(&adapt);
+ #endif
          }
  
        } else if(state == ST_COLLECTING) {
          /* collect light + motion */
-         int16_t light = opt_3001_sensor.value(0);
-         buffer[buf_tail].light[sample_idx]  = light;
-         buffer[buf_tail].motion[sample_idx] = motion;
+         sample_set_t *set = COLLECTING;
+         int16_t light = sensor_src_light();
+ #if SUMMARY_UPLOAD
+         if(sample_idx == 0) set_start = now_stamp();
+         feat_add(&acc_light, light);
+         feat_add(&acc_motion, motion);
+         set->span = now_stamp() - set_start;
+ #else
+         set->light[sample_idx]  = light;
+         set->motion[sample_idx] = motion;
+ #if ADAPTIVE_SAMPLING
+         set->stamp[sample_idx]  = now_stamp();
+ #endif
+ #endif
+ #if ADAPTIVE_SAMPLING
+         adapt_level_t lvl = adapt_update(&adapt, motion);
+         next = lvl == ADAPT_FAST ? FAST_INTERVAL :
+                lvl == ADAPT_SLOW ? SLOW_INTERVAL : SAMPLE_INTERVAL;
+ #endif
          sample_idx++;
+         act_sum += abs(motion);
+         act_n++;
  
          if(sample_idx >= SAMPLES) {
            /* complete set */
-           buf_tail = (buf_tail + 1) % MAX_SETS;
-           buf_len++;
-           printf("%lu Set collected - buffer=%u\n", clock_seconds(), buf_len);
+ #if SUMMARY_UPLOAD
+           feat_finish(&acc_light, &set->f_light);
+           feat_finish(&acc_motion, &set->f_motion);
+ #endif
+           set->id       = set_id++;
+           set->activity = act_sum / act_n;
+           uint8_t lost  = setq_put(&queue, set->activity);
+           if(lost != SETQ_NONE) {
+             EVLOG_WARN(EV_A_SET_DROP, buffer[lost].id, buffer[lost].activity,
+                        queue.dropped);
+           }
+ #if PRE_SAMPLES
+           pre_head = pre_count = 0;       /* history restarts in the new slot */
+ #endif
+           EVLOG_INFO(EV_A_SET_DONE, clock_seconds(), queue.len);
            state = ST_IDLE;
+           next  = SAMPLE_INTERVAL;
+         }
+       }
  
-           /* trigger upload if we are not already sending */
-           if(!buf_empty() && state != ST_SENDING) {
-             state = ST_SENDING;
-             rtimer_set(&rt, RTIMER_NOW() + RTIMER_SECOND / 5, 0,
-                        rt_send_req, NULL);
-           }
+       /* trigger upload if we are not already sending and it is due */
+       if(!uploading && upload_due()) {
+         uploading = 1;
+         tx_wait   = 0;
+         good_cnt  = 0;
+         if(!alert_active) {            /* else started by resume_upload() */
+           upload_start(RTIMER_SECOND / 5);
          }
+       } else if(tx_wait && !alert_active && frame_slices(tx_seq)) {
+         /* streaming: link still up, send the frame just filled */
+         tx_wait = 0;
+         tx_n    = frame_slices(tx_seq);
+         slot_sched_start(&sched, RTIMER_SECOND / 20, rt_send_chunk, NULL);
        }
  
-       etimer_reset(&sample_timer);
+       etimer_reset_with_new_interval(&sample_timer, next);
      }
    }
  
@@ -10,45 +10,21 @@
 #include "net/netstack.h"
 #include "net/packetbuf.h"
 #include "node-id.h"
+#include "protocol.h"
+#include "slot_sched.h"
 
 #define SAMPLES 60 // No. of samples we are collecting
-#define CHUNK_SIZE 20 // Number of readings in each packet (chunk)
+#define CHUNK_SIZE PROTO_CHUNK_SIZE // Number of readings in each packet (chunk)
 
 #define WAKE_TIME (RTIMER_SECOND / 10)   // Wake time for neighbour discovery
 #define SLEEP_INTERVAL (RTIMER_SECOND / 4)    // Sleep time between receiving
 
-// Packet types
-#define PKT_BEACON 0x01
-#define PKT_REQUEST 0x02
-#define PKT_DATA 0x03
-#define PKT_ACK 0x04
-#define PKT_REQ_ACK 0x05
-
-typedef struct __attribute__((packed)) {
-  uint8_t type;  // Packet type
-  uint16_t src_id;
-} req_pkt_t;
-
-typedef struct __attribute__((packed)) {
-  uint8_t type;
-  uint16_t src_id;
-  uint8_t seq; // Chunk number
-} ack_pkt_t;
-
-typedef struct __attribute__((packed)) {
-  uint8_t type;
-  uint16_t src_id;
-  uint8_t seq;
-  int16_t payload[CHUNK_SIZE * 2]; // Light and motion data
-} data_pkt_t;
-
-
 static uint8_t chunks_received = 0; // No. of chunks received so far
 static uint8_t is_tranmission_complete = 0; 
 static int16_t light_readings[SAMPLES];
 static int16_t motion_readings[SAMPLES];
 
-static struct rtimer rt;
+static slot_sched_t sched; // all rtimer steps run on this grid
 static void end_listen(struct rtimer *t, void *ptr);
 static void start_listen(struct rtimer *t, void *ptr);
 static void node_b_receive_callback(const void *data, uint16_t len, const linkaddr_t *src, const linkaddr_t *dest);
@@ -56,57 +32,57 @@ static void node_b_receive_callback(const void *data, uint16_t len, const linkad
 // End listening and schedule next listen
 static void end_listen(struct rtimer *t, void *ptr) {
   NETSTACK_RADIO.off();
-  rtimer_set(&rt, RTIMER_NOW() + SLEEP_INTERVAL, 0, start_listen, NULL);
+  slot_sched_next(&sched, SLEEP_INTERVAL, start_listen, NULL);
 }
 
 // Start listening 
 static void start_listen(struct rtimer *t, void *ptr) {
   NETSTACK_RADIO.on();
-  rtimer_set(&rt, RTIMER_NOW() + WAKE_TIME, 0, end_listen, NULL);
+  slot_sched_next(&sched, WAKE_TIME, end_listen, NULL);
 }
 
 
 static void node_b_receive_callback(const void *data, uint16_t len, const linkaddr_t *src, const linkaddr_t *dest) {
-  if(len == 0) {
+  uint8_t packet_type = proto_type(data, len);
+  if(packet_type == 0 || len < sizeof(req_pkt_t)) {
     return;
   }
-  uint8_t packet_type = ((const uint8_t*)data)[0];
 
+  // Every frame starts with the request header (type + sender id)
   const req_pkt_t *header = (const req_pkt_t *)data;
   printf("%lu DETECT node %u\n", clock_seconds(), header->src_id);
 
-  if(packet_type == PKT_REQUEST) {
-    ack_pkt_t ra = { PKT_REQ_ACK, node_id, 0 };
+  if(packet_type == PKT_REQUEST && proto_req_view(data, len)) {
+    static ack_pkt_t ra;
     nullnet_buf = (uint8_t *)&ra;
-    nullnet_len = sizeof(ra);
+    nullnet_len = proto_build_ack(&ra, PKT_REQ_ACK, node_id, 0);
     NETSTACK_NETWORK.output(src);
     printf("Sending REQ_ACK\n\n");
   } else if(packet_type == PKT_DATA) {
-    data_pkt_t pkt;
-    memcpy(&pkt, data, len);
-
-    printf("Receiving Data chunk %d\n", pkt.seq);
-    
-    for(uint8_t i=0; i<CHUNK_SIZE; i++) {
-      uint8_t idx = pkt.seq*CHUNK_SIZE + i;
-      light_readings[idx] = pkt.payload[2*i];
-      motion_readings[idx] = pkt.payload[2*i+1];
-      // printf(" sample %d  light=%d  motion=%d\n",
-      //        idx, light_readings[idx], motion_readings[idx]);
+    const data_pkt_t *pkt = proto_data_view(data, len);
+    if(pkt == NULL || pkt->seq >= SAMPLES / CHUNK_SIZE) {
+      return;
     }
 
+    printf("Receiving Data chunk %d\n", pkt->seq);
+
+    // Payload goes straight into the reassembly arrays, no stack copy
+    uint8_t off = pkt->seq*CHUNK_SIZE;
+    proto_data_unpack(pkt, &light_readings[off], &motion_readings[off]);
+
     chunks_received++;
     if(chunks_received == 3) {
         is_tranmission_complete = 1;
     }
 
-    ack_pkt_t ack = { PKT_ACK, node_id, pkt.seq };
+    static ack_pkt_t ack;
+    uint16_t ack_len = proto_build_ack(&ack, PKT_ACK, node_id, pkt->seq);
     for(int i = 0;i < 5;i++){
         nullnet_buf = (uint8_t *)&ack;
-        nullnet_len = sizeof(ack);
+        nullnet_len = ack_len;
         NETSTACK_NETWORK.output(src);
     }
-    printf("Transmitted ACK for chunk %d\n\n", pkt.seq);
+    printf("Transmitted ACK for chunk %d\n\n", pkt->seq);
   }
 
   if(is_tranmission_complete) {
@@ -131,6 +107,6 @@ AUTOSTART_PROCESSES(&node_b_proc);
 PROCESS_THREAD(node_b_proc, ev, data){
   PROCESS_BEGIN();
   nullnet_set_input_callback(node_b_receive_callback);
-  rtimer_set(&rt, RTIMER_NOW() + WAKE_TIME, 0, start_listen, NULL);
+  slot_sched_start(&sched, WAKE_TIME, start_listen, NULL);
   PROCESS_END();
 }
\ No newline at end of file
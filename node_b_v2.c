@@ -3,13 +3,97 @@
  *
  * – Listens in 100 ms windows (WAKE_TIME) every 100 ms (SLEEP_INTERVAL).
  * – On PKT_REQUEST, returns PKT_REQ_ACK only if |motion| < MOTIONLESS_THRESHOLD.
- * – On PKT_DATA, stores chunk and replies with PKT_ACK.
+ * – On PKT_RUN / PKT_RUN_TS, stores the run at its sample offset (any
+ *   offset and length – Node A sizes frames to the link) and replies
+ *   with PKT_ACK carrying the offset, or with PROTO_BLOCK_ACK one
+ *   PKT_BLOCK_ACK per burst: sent at once when the set is complete,
+ *   else BLOCK_ACK_DELAY after the last frame (the listen window is
+ *   held open until then, and for one more window after a complete
+ *   set, so the sender can go on with its next one in the same
+ *   session).  Parity frames that follow a burst are kept
+ *   until the set is complete; a run that is the only one missing from
+ *   a parity group is rebuilt by XOR and counts as received.  The block
+ *   ACK reports how many frames were heard so Node A can size frames
+ *   and parity to the loss rate.
+ *   PKT_RUN_TS sets carry per‑sample time deltas; the set's time
+ *   offsets are rebuilt once all samples are in.
+ * – On PKT_SUMMARY (Node A in summary mode), logs the set's features
+ *   and replies with PKT_ACK seq 0; retransmissions are acked again but
+ *   logged once.
+ * – RI_MODE (NODE_B_CONF_RI): every listen window opens with a broadcast
+ *   PKT_BEACON while motionless, so receiver‑initiated Node As can send
+ *   without requesting first.  The motion check for the beacon runs
+ *   once per second in the process, not in the rtimer callback.
+ * – On PKT_ALERT, replies PKT_ALERT_ACK regardless of motion and
+ *   flushes the log right away so the alert is not held back by
+ *   the evlog flush interval.
+ * – DISC_MODE (NODE_B_CONF_DISCOVERY): the discovery beacons of Node As
+ *   built with NODE_A_CONF_DISCOVERY (protocol.h disc_pkt_t) are
+ *   answered, while motionless, with the RSSI they were heard at and –
+ *   for a tag with a set – the time to the next listen window, where
+ *   its set is sent without a REQUEST handshake.  A beacon heard while
+ *   the window is held open for another transfer is not answered.
+ * – RELAY_MODE (NODE_B_CONF_RELAY): store and forward.  Completed sets
+ *   are queued (relay.h) and handed hop by hop to RELAY_PARENT
+ *   (NODE_B_CONF_RELAY_PARENT, node id; 0 = this node is the sink and
+ *   logs them).  Once RELAY_BATCH sets are queued, or the oldest has
+ *   waited RELAY_MAX_AGE, up to RELAY_BATCH_MAX sets go out in one
+ *   batch: frame 0 is strobed until the duty‑cycled parent's listen
+ *   window catches it and it answers, then the rest follows as a burst.
+ *   The parent acknowledges per hop with a PKT_BLOCK_ACK bitmap; only
+ *   missing frames are resent.  A parent whose queue is full leaves new
+ *   sets unacknowledged, so the child keeps them and backs off
+ *   (retry_ctl.h) instead of losing them.
+ * – SET_DUMP (NODE_B_CONF_SET_DUMP): every complete set – and at the
+ *   sink every relayed one – is printed as one checksummed line for
+ *   the host gateway (gateway/gw.c):
+ *     $SET,<origin>,<collector>,<set_no>,<n>,<n × LLLLMMMMDD hex>*CS
+ *   light / motion as 16‑bit two's complement, DD the gap to the
+ *   previous sample in PROTO_TICK_MS units, CS the XOR of all
+ *   characters between '$' and '*' (NMEA style).  Printed from the
+ *   process, not the radio path; sets acknowledged meanwhile wait in a
+ *   queue of OUT_QUEUE – a whole relay batch and the set of a session
+ *   that goes on right after it.
+ * – SET_LOG (NODE_B_CONF_SET_LOG): the same sets are appended to the
+ *   external flash (setlog.h), so the node can run unattended.  A line
+ *   "DUMP [seq]" on the serial console prints the log, oldest first,
+ *   from record seq on:
+ *     $LOG,<seq>,<age_s>,<origin>,<collector>,<set_no>,<n>,<records>*CS
+ *   per set (records and CS as $SET, age −1 if logged before the last
+ *   reset), then $END,<sets printed>,<next seq>*CS.  One record per
+ *   process turn, so reception goes on during a long dump.  A logged set
+ *   is also printed live as $LOG (age 0) rather than $SET, so the
+ *   gateway knows it by seq when a dump brings it again.
+ * – QUERY_MODE (NODE_B_CONF_QUERY): pull queries over an in‑memory
+ *   index of the logged sets (setidx.h), so consumers fetch only what
+ *   they need.  Over the radio a MGMT_QUERY frame (protocol.h) is
+ *   answered with up to QUERY_FRAMES MGMT_REPLY frames; the requester
+ *   asks again with skip for the rest.  The process builds one frame
+ *   at a time and it goes out at the start of the next listen window
+ *   that no block ACK is pending in, so replies keep to the duty cycle
+ *   and never cut into a transfer or a hop.  On the serial console:
+ *     SETS <sender|*> [span_s [skip]]    $QS,<seq>,<origin>,<age_s>,<light>,<motion>*CS
+ *     HOURLY <sender|*> [span_s [skip]]  $QH,<origin>,<hour>,<sets>,<light>,<motion>*CS
+ *   then $QEND,<entries>*CS; light / motion are set means, age −1 for
+ *   sets from before the last reset.
+ * – TDMA_MODE (NODE_B_CONF_TDMA): the listen cycles form a superframe
+ *   of 1 + TDMA_SLOTS cycles.  A REQ_ACK (still only while motionless)
+ *   gives the requester a cycle of its own, the time to its next start
+ *   and the superframe period (slot_ack_pkt_t, protocol.h); Node B
+ *   listens through the whole of an owned cycle and its owner sends
+ *   only there, without a new handshake while the slot's lease
+ *   (PROTO_SLOT_LEASE) is renewed by its frames.  Cycle 0 is never
+ *   given away, for handshakes, alerts and queries.  A tag that finds
+ *   every slot taken gets a plain REQ_ACK and contends as before.
+ *   A run from another tag drops a half‑received set; its owner sends
+ *   it again from the start in its next slot.
+ * – Frames are parsed in place (protocol.h); run records are written
+ *   straight into light_buf / motion_buf.
  */
 
  #include <stdio.h>
  #include <stdlib.h>
  #include <stdint.h>
- #include <math.h>
  #include <string.h>
  #include "contiki.h"
  #include "sys/rtimer.h"
@@ -17,117 +101,1018 @@
  #include "net/netstack.h"
  #include "net/packetbuf.h"
  #include "node-id.h"
- #include "board-peripherals.h"
+ #include "evlog.h"
+ #include "protocol.h"
+ #include "slot_sched.h"
+ #include "sensor_src.h"
+ #include "relay.h"
+ #include "retry_ctl.h"
+ #include "setlog.h"
+ #include "setidx.h"
+ #include "dev/serial-line.h"
  
  /* ------------ parameters ------------ */
  #define MOTIONLESS_THRESHOLD   1     /* centi‑g */
  #define SAMPLES                60
- #define CHUNK_SIZE             20
  
  #define WAKE_TIME              (RTIMER_SECOND / 10)
  #define SLEEP_INTERVAL         (RTIMER_SECOND / 10)
  
- /* ------------ packet types ------------ */
- #define PKT_BEACON   0x01
- #define PKT_REQUEST  0x02
- #define PKT_DATA     0x03
- #define PKT_ACK      0x04
- #define PKT_REQ_ACK  0x05
- 
- /* ------------ packet formats ------------ */
- typedef struct __attribute__((packed)) {
-   uint8_t  type;
-   uint16_t src_id;
- } req_pkt_t;
- 
- typedef struct __attribute__((packed)) {
-   uint8_t  type;
-   uint16_t src_id;
-   uint8_t  seq;
- } ack_pkt_t;
- 
- typedef struct __attribute__((packed)) {
-   uint8_t  type;
-   uint16_t src_id;
-   uint8_t  seq;
-   int16_t  payload[CHUNK_SIZE * 2];
- } data_pkt_t;
+ #ifdef NODE_B_CONF_RI
+ #define RI_MODE                NODE_B_CONF_RI
+ #else
+ #define RI_MODE                0
+ #endif
+ #define MOTION_CHECK_INTERVAL  CLOCK_SECOND
+ #define BLOCK_ACK_DELAY        (CLOCK_SECOND / 32)   /* burst gap + margin */
+ #define SET_MASK               ((1ULL << SAMPLES) - 1)
+ #define PARITY_SLOTS           2     /* parity frames kept per set */
+ 
+ #ifdef NODE_B_CONF_RELAY
+ #define RELAY_MODE             NODE_B_CONF_RELAY
+ #else
+ #define RELAY_MODE             0
+ #endif
+ #ifdef NODE_B_CONF_RELAY_PARENT
+ #define RELAY_PARENT           NODE_B_CONF_RELAY_PARENT
+ #else
+ #define RELAY_PARENT           0     /* sink */
+ #endif
+ #define RELAY_FORWARD          (RELAY_MODE && RELAY_PARENT != 0)
+ 
+ #ifdef NODE_B_CONF_SET_DUMP
+ #define SET_DUMP               NODE_B_CONF_SET_DUMP
+ #else
+ #define SET_DUMP               1
+ #endif
+ #ifdef NODE_B_CONF_SET_LOG
+ #define SET_LOG                NODE_B_CONF_SET_LOG
+ #else
+ #define SET_LOG                1
+ #endif
+ #define SET_OUT                (SET_DUMP || SET_LOG)
+ #ifdef NODE_B_CONF_QUERY
+ #define QUERY_MODE             NODE_B_CONF_QUERY
+ #else
+ #define QUERY_MODE             1
+ #endif
+ #define QUERY_FRAMES           4     /* reply frames per radio query */
+ #if QUERY_MODE && !SET_LOG
+ #error "NODE_B_CONF_QUERY indexes the set log (NODE_B_CONF_SET_LOG)"
+ #endif
+ #ifdef NODE_B_CONF_TDMA
+ #define TDMA_MODE              NODE_B_CONF_TDMA
+ #else
+ #define TDMA_MODE              0
+ #endif
+ #ifdef NODE_B_CONF_TDMA_SLOTS
+ #define TDMA_SLOTS             NODE_B_CONF_TDMA_SLOTS
+ #else
+ #define TDMA_SLOTS             4     /* transfer slots per superframe */
+ #endif
+ #define CYCLE                  (WAKE_TIME + SLEEP_INTERVAL)
+ #define TDMA_CYCLES            (TDMA_SLOTS + 1)    /* cycle 0: contention */
+ #define TICKS_MS(t)            ((uint16_t)((uint32_t)(t) * 1000 / RTIMER_SECOND))
+ #if TDMA_MODE && !PROTO_BLOCK_ACK
+ #error "NODE_B_CONF_TDMA needs PROTO_BLOCK_ACK"
+ #endif
+ #if TDMA_MODE && RELAY_FORWARD
+ #error "NODE_B_CONF_TDMA keeps the listen grid fixed, no relay forwarding"
+ #endif
+ #ifdef NODE_B_CONF_DISCOVERY
+ #define DISC_MODE              NODE_B_CONF_DISCOVERY
+ #else
+ #define DISC_MODE              0
+ #endif
+ #if DISC_MODE && TDMA_MODE
+ #error "NODE_B_CONF_DISCOVERY meets in the next window, which TDMA may have given away"
+ #endif
+ #define RELAY_BATCH            2     /* sets that start a hop transfer */
+ #define RELAY_MAX_AGE          60    /* s: or the oldest set waited this */
+ #define RELAY_CHECK            CLOCK_SECOND
+ #define RELAY_STROBE           (RTIMER_SECOND / 50)  /* probe spacing */
+ #define RELAY_STROBE_TRIES     12    /* > one listen cycle of the parent */
+ #define RELAY_BURST_GAP        (RTIMER_SECOND / 100)
+ #define RELAY_ACK_WAIT         (RTIMER_SECOND / 20)
+ #define RELAY_ROUNDS           3     /* burst + ACK rounds per attempt */
+ #define RELAY_COST_MS          ((uint16_t)(RELAY_STROBE_TRIES * 1000UL * \
+                                            RELAY_STROBE / RTIMER_SECOND))
+ #if RELAY_MODE && !PROTO_BLOCK_ACK
+ #error "NODE_B_CONF_RELAY acknowledges hops with PKT_BLOCK_ACK (PROTO_BLOCK_ACK)"
+ #endif
+ #if RELAY_MODE && RELAY_SAMPLES != SAMPLES
+ #error "RELAY_SAMPLES must match SAMPLES"
+ #endif
  
  /* ------------ storage for one sample set ------------ */
  static int16_t light_buf[SAMPLES];
  static int16_t motion_buf[SAMPLES];
- static uint8_t chunks_rx = 0;          /* bitmask 0b00000111 */
+ static uint8_t dt_buf[SAMPLES];        /* PKT_DATA_TS deltas */
+ static uint16_t t_off_buf[SAMPLES];    /* PROTO_TICK_MS units  */
+ static uint64_t samples_rx = 0;        /* bit i = sample i stored */
+ static uint8_t has_ts    = 0;
+ static int16_t last_summary = -1;      /* set number of the last summary */
+ static int16_t last_alert   = -1;
+ static uint16_t set_origin;            /* Node A of the set being received */
+ static uint8_t  set_no = 0;            /* sets completed here */
+ #if SET_OUT
+ #define OUT_QUEUE              (RELAY_BATCH_MAX + 1)
+ static struct out_set {
+   uint16_t origin;
+   uint16_t collector;
+   uint8_t  set_no;
+   int16_t  light[SAMPLES];
+   int16_t  motion[SAMPLES];
+   uint8_t  dt[SAMPLES];
+ } out[OUT_QUEUE + 1];                       /* ring, one slot kept free */
+ static volatile uint8_t out_head = 0;       /* radio path adds here */
+ static volatile uint8_t out_tail = 0;       /* the process logs from here */
+ #endif
+ #if SET_LOG
+ enum { JOB_NONE = 0, JOB_DUMP, JOB_QUERY };
+ static uint8_t  serial_job = JOB_NONE;  /* one page per CONTINUE event */
+ static uint16_t serial_lines;
+ static setlog_iter_t log_it;
+ static int16_t  log_light[SAMPLES];
+ static int16_t  log_motion[SAMPLES];
+ static uint8_t  log_dt[SAMPLES];
+ #endif
+ #if QUERY_MODE
+ static query_pkt_t serial_query;
+ static query_pkt_t radio_query;
+ static linkaddr_t  query_from;
+ static volatile uint8_t query_pending = 0;  /* radio query for the process */
+ static volatile uint8_t query_ready = 0;    /* reply frame for start_listen */
+ static reply_pkt_t query_reply;
+ static uint16_t    query_len;
+ static uint16_t    query_skip;              /* entry the next frame starts at */
+ static uint8_t     query_more;
+ static uint8_t     query_frames;            /* built so far */
+ #endif
  
  /* ------------ timers ------------ */
- static struct rtimer rt;
- 
- /* ------------ helpers ------------ */
- static int16_t read_motion(void)
- {
-   int16_t ax = mpu_9250_sensor.value(MPU_9250_SENSOR_TYPE_ACC_X);
-   int16_t ay = mpu_9250_sensor.value(MPU_9250_SENSOR_TYPE_ACC_Y);
-   int16_t az = mpu_9250_sensor.value(MPU_9250_SENSOR_TYPE_ACC_Z);
-   float g = sqrtf((float)(ax*ax + ay*ay + az*az)) / 16384.0f;
-   return (int16_t)(g * 100);          /* centi‑g */
- }
+ static slot_sched_t sched;
+ #if PROTO_BLOCK_ACK
+ static struct etimer block_ack_timer;
+ static uint8_t    back_pending = 0;     /* frames in, block ACK not sent */
+ static linkaddr_t back_to;
+ static uint8_t    burst_rx = 0;         /* frames since the last block ACK */
+ static uint8_t    linger = 0;           /* set done, its sender may go on */
+ static struct {
+   run_pkt_t pkt;
+   uint8_t   n;                          /* samples per run of the group */
+ } parity[PARITY_SLOTS];
+ static uint8_t    parity_n  = 0;
+ static uint8_t    parity_ok = 0;        /* a run of the current set is in */
+ #endif
+ #if RELAY_MODE
+ static uint8_t    relay_pending = 0;     /* child frames in, ACK not sent */
+ static linkaddr_t relay_child;
+ static uint8_t    relay_rx_batch;
+ static uint16_t   relay_rx_map;
+ static uint8_t    relay_rx_heard;
+ #endif
+ #if RELAY_FORWARD
+ static linkaddr_t relay_parent = { .u8 = { RELAY_PARENT >> 8, RELAY_PARENT & 0xFF } };
+ static struct etimer relay_timer;
+ static retry_ctl_t relay_retry;
+ static volatile uint8_t relay_busy = 0;  /* hop transfer owns the radio */
+ static volatile uint8_t relay_ended = 0; /* for the process: re‑arm timer */
+ static rtimer_clock_t relay_wait;        /* backoff after a failed one */
+ static uint8_t    relay_batch_no = 0;
+ static uint8_t    relay_frames;
+ static uint16_t   relay_map;             /* frames the parent confirmed */
+ static uint8_t    relay_idx;
+ static uint8_t    relay_round;
+ static uint8_t    relay_strobe_left;
+ #endif
+ #if RI_MODE
+ static struct etimer motion_timer;
+ static volatile uint8_t motionless = 0;   /* refreshed by the process */
+ #endif
+ #if TDMA_MODE
+ static struct {
+   uint16_t      id;                       /* owner, 0: never given */
+   unsigned long seen;                     /* clock_seconds() last heard */
+ } tdma[TDMA_SLOTS];                       /* slot s is cycle s + 1 */
+ static uint8_t        tdma_cycle = 0;     /* cycle of the superframe now */
+ static rtimer_clock_t tdma_at;            /* its start */
+ #endif
+ #if DISC_MODE
+ static rtimer_clock_t win_at;             /* start of the listen window */
+ #endif
  
  /* ---- duty‑cycle callbacks ---- */
  static void start_listen(struct rtimer *t, void *ptr);
  static void end_listen(struct rtimer *t, void *ptr);
  
+ PROCESS_NAME(node_b_process);
+ 
+ #if TDMA_MODE
+ /* ------------ TDMA slots ------------ */
+ static uint8_t tdma_live(uint8_t s)
+ {
+   return tdma[s].id != 0 && clock_seconds() - tdma[s].seen < PROTO_SLOT_LEASE;
+ }
+ 
+ /* a frame from id renews its lease */
+ static void tdma_heard(uint16_t id)
+ {
+   for(uint8_t s = 0; s < TDMA_SLOTS; s++) {
+     if(tdma[s].id == id) tdma[s].seen = clock_seconds();
+   }
+ }
+ 
+ /* id's slot, else a free or expired one; TDMA_SLOTS if all are taken */
+ static uint8_t tdma_grant(uint16_t id)
+ {
+   uint8_t s, free = TDMA_SLOTS;
+   for(s = 0; s < TDMA_SLOTS && tdma[s].id != id; s++) {
+     if(free == TDMA_SLOTS && !tdma_live(s)) free = s;
+   }
+   if(s == TDMA_SLOTS) s = free;
+   if(s < TDMA_SLOTS) {
+     tdma[s].id   = id;
+     tdma[s].seen = clock_seconds();
+   }
+   return s;
+ }
+ 
+ /* from now to the next start of slot s */
+ static rtimer_clock_t tdma_wait(uint8_t s)
+ {
+   uint8_t ahead = (s + 1 + TDMA_CYCLES - tdma_cycle) % TDMA_CYCLES;
+   if(ahead == 0) ahead = TDMA_CYCLES;      /* this one has begun */
+   return tdma_at + ahead * CYCLE - RTIMER_NOW();
+ }
+ #endif
+ 
  static void end_listen(struct rtimer *t, void *ptr)
  {
+ #if TDMA_MODE
+   if(back_pending || linger ||
+      (tdma_cycle > 0 && tdma_live(tdma_cycle - 1))) {
+     /* burst in progress, next set of a session or an owned slot: stay
+      * on into the next cycle, which keeps the slot grid */
+     linger = 0;
+     slot_sched_next(&sched, SLEEP_INTERVAL, start_listen, NULL);
+     return;
+   }
+ #elif RELAY_MODE
+   if(back_pending || relay_pending || linger) {
+     /* burst in progress: stay on until the block ACK is out, and once
+      * more after a complete set for the sender's next one */
+     linger = 0;
+     slot_sched_next(&sched, WAKE_TIME, end_listen, NULL);
+     return;
+   }
+ #elif PROTO_BLOCK_ACK
+   if(back_pending || linger) {
+     /* burst in progress: stay on until the block ACK is out, and once
+      * more after a complete set for the sender's next one */
+     linger = 0;
+     slot_sched_next(&sched, WAKE_TIME, end_listen, NULL);
+     return;
+   }
+ #endif
    NETSTACK_RADIO.off();
-   rtimer_set(&rt, RTIMER_NOW() + SLEEP_INTERVAL, 0, start_listen, NULL);
+   slot_sched_next(&sched, SLEEP_INTERVAL, start_listen, NULL);
  }
  
  static void start_listen(struct rtimer *t, void *ptr)
  {
    NETSTACK_RADIO.on();
-   rtimer_set(&rt, RTIMER_NOW() + WAKE_TIME, 0, end_listen, NULL);
+ #if TDMA_MODE
+   tdma_cycle = (tdma_cycle + 1) % TDMA_CYCLES;
+   tdma_at    = sched.deadline;
+ #endif
+ #if DISC_MODE
+   win_at = sched.deadline;
+ #endif
+ #if RI_MODE
+   if(motionless) {
+     /* "ready to receive" for the window that starts now */
+     static req_pkt_t beacon;
+     nullnet_buf = (uint8_t *)&beacon;
+     nullnet_len = proto_build_req(&beacon, PKT_BEACON, node_id);
+     NETSTACK_NETWORK.output(NULL);
+   }
+ #endif
+ #if QUERY_MODE
+   uint8_t rx_busy = 0;
+ #if PROTO_BLOCK_ACK
+   rx_busy = back_pending;              /* TDMA: a burst runs on */
+ #endif
+   if(query_ready && !rx_busy) {
+     /* a reply frame per window; the process builds the next one */
+     nullnet_buf = (uint8_t *)&query_reply;
+     nullnet_len = query_len;
+     NETSTACK_NETWORK.output(&query_from);
+     query_ready = 0;
+     process_poll(&node_b_process);
+   }
+ #endif
+   slot_sched_next(&sched, WAKE_TIME, end_listen, NULL);
+ }
+ 
+ /* bits off … off+n−1 */
+ static inline uint64_t run_mask(uint8_t off, uint8_t n)
+ {
+   return ((1ULL << n) - 1) << off;
+ }
+ 
+ #if PROTO_BLOCK_ACK
+ /* PROTO_SLICE‑sample slices that are complete, as block ACK bits */
+ static uint16_t slice_map(void)
+ {
+   uint16_t map = 0;
+   for(uint8_t k = 0; k < SAMPLES / PROTO_SLICE; k++) {
+     uint64_t m = run_mask(k * PROTO_SLICE, PROTO_SLICE);
+     if((samples_rx & m) == m) map |= 1 << k;
+   }
+   return map;
+ }
+ 
+ static void send_block_ack(void)
+ {
+   static block_ack_pkt_t back;
+   uint16_t map = slice_map();
+   back_pending = 0;
+   nullnet_buf = (uint8_t *)&back;
+   nullnet_len = proto_build_block_ack(&back, node_id, map, burst_rx);
+   NETSTACK_NETWORK.output(&back_to);
+   EVLOG_DBG(EV_B_BLOCK_ACK, map, burst_rx);
+   burst_rx = 0;
+ }
+ 
+ /* rebuild every run that is the only one missing from a parity group;
+  * one rebuilt run can complete another group, so repeat until stable */
+ static void fec_recover(void)
+ {
+   uint8_t progress = 1;
+   while(progress) {
+     progress = 0;
+     for(uint8_t p = 0; p < parity_n; p++) {
+       const run_pkt_t *par = &parity[p].pkt;
+       uint8_t n      = parity[p].n;
+       uint8_t stride = PROTO_PARITY_STRIDE(par->off);
+       uint8_t miss   = 0xFF;
+       uint8_t c;
+ 
+       for(c = PROTO_PARITY_FIRST(par->off); c * n < SAMPLES; c += stride) {
+         uint64_t m = run_mask(c * n, n);
+         if((samples_rx & m) == m) continue;
+         if(miss != 0xFF) break;                  /* two missing */
+         miss = c;
+       }
+       if(miss == 0xFF || c * n < SAMPLES) continue;
+ 
+       /* start from the parity records, XOR the other runs back out */
+       int16_t *light  = &light_buf[miss * n];
+       int16_t *motion = &motion_buf[miss * n];
+       uint8_t *dt     = &dt_buf[miss * n];
+       proto_run_unpack(par, n, light, motion, dt);
+       for(c = PROTO_PARITY_FIRST(par->off); c * n < SAMPLES; c += stride) {
+         if(c == miss) continue;
+         for(uint8_t i = 0; i < n; i++) {
+           light[i]  ^= light_buf[c * n + i];
+           motion[i] ^= motion_buf[c * n + i];
+           dt[i]     ^= dt_buf[c * n + i];
+         }
+       }
+       samples_rx |= run_mask(miss * n, n);
+       progress = 1;
+       EVLOG_INFO(EV_B_FEC_RECOVER, miss * n, n);
+     }
+   }
+ }
+ 
+ /* a data or parity frame of a burst is in: block ACK now if the set is
+  * complete, else once the burst has gone quiet */
+ static void burst_frame(const linkaddr_t *src)
+ {
+   burst_rx++;
+   fec_recover();
+   linkaddr_copy(&back_to, src);
+   if(samples_rx == SET_MASK) {
+     send_block_ack();
+     linger = 1;
+   } else {
+     back_pending = 1;
+     process_poll(&node_b_process);   /* (re)arms block_ack_timer */
+   }
+ }
+ #endif
+ 
+ #if SET_OUT
+ /* ------------ set output: flash log / gateway ------------ */
+ static void set_out(uint16_t origin, uint16_t collector, uint8_t no,
+                     const int16_t *light, const int16_t *motion,
+                     const uint8_t *dt)
+ {
+   uint8_t next = (out_head + 1) % (OUT_QUEUE + 1);
+ 
+   if(next == out_tail) {
+     EVLOG_WARN(EV_B_OUT_BUSY, origin, no);
+     return;
+   }
+   out[out_head].origin    = origin;
+   out[out_head].collector = collector;
+   out[out_head].set_no    = no;
+   memcpy(out[out_head].light,  light,  sizeof(out[0].light));
+   memcpy(out[out_head].motion, motion, sizeof(out[0].motion));
+   memcpy(out[out_head].dt,     dt,     sizeof(out[0].dt));
+   out_head = next;
+   process_poll(&node_b_process);
+ }
+ 
+ /* print s, return the checksum continued over it */
+ static uint8_t line_put(const char *str, uint8_t cs)
+ {
+   for(const char *c = str; *c; c++) cs ^= (uint8_t)*c;
+   printf("%s", str);
+   return cs;
+ }
+ 
+ /* $<head><n records>*CS; head holds the fields before the records */
+ static void line_print(const char *head, uint8_t n, const int16_t *light,
+                        const int16_t *motion, const uint8_t *dt)
+ {
+   char    buf[12];
+   uint8_t cs;
+ 
+   printf("$");
+   cs = line_put(head, 0);
+   for(uint8_t i = 0; i < n; i++) {
+     snprintf(buf, sizeof(buf), "%04X%04X%02X", (uint16_t)light[i],
+              (uint16_t)motion[i], dt[i]);
+     cs = line_put(buf, cs);
+   }
+   printf("*%02X\n", cs);
+ }
+ 
+ /* process context: the queued sets go to flash and console */
+ static void out_flush(void)
+ {
+   while(out_tail != out_head) {
+     const struct out_set *o = &out[out_tail];
+ #if SET_LOG
+     uint32_t seq = setlog_append(o->origin, o->collector, o->set_no,
+                                  SAMPLES, o->light, o->motion, o->dt);
+     if(seq == SETLOG_NONE) {
+       EVLOG_WARN(EV_B_LOG_LOST, o->origin, o->set_no);
+ #if QUERY_MODE
+     } else {
+       setidx_add(seq, o->origin, 1, clock_seconds(), SAMPLES, o->light,
+                  o->motion);
+ #endif
+     }
+ #endif
+ #if SET_DUMP
+     char head[48];
+ #if SET_LOG
+     if(seq != SETLOG_NONE) {
+       snprintf(head, sizeof(head), "LOG,%lu,0,%u,%u,%u,%u,",
+                (unsigned long)seq, o->origin, o->collector, o->set_no,
+                SAMPLES);
+     } else
+ #endif
+     snprintf(head, sizeof(head), "SET,%u,%u,%u,%u,", o->origin,
+              o->collector, o->set_no, SAMPLES);
+     line_print(head, SAMPLES, o->light, o->motion, o->dt);
+ #endif
+     out_tail = (out_tail + 1) % (OUT_QUEUE + 1);
+   }
+ }
+ #endif
+ 
+ #if QUERY_MODE
+ /* the page of the answer to q from entry skip on into r; *more if
+  * entries follow it */
+ static uint8_t query_page(const query_pkt_t *q, uint16_t skip,
+                           reply_pkt_t *r, uint8_t *more)
+ {
+   if(q->kind == QUERY_SETS) {
+     return setidx_sets(q->sender, q->span, skip, r->set,
+                        PROTO_REPLY_SETS, more);
+   }
+   if(q->kind == QUERY_HOURLY) {
+     return setidx_hourly(q->sender, q->span, skip, r->hour,
+                          PROTO_REPLY_HOURS, more);
+   }
+   *more = 0;
+   return 0;
+ }
+ 
+ /* process context: the next of up to QUERY_FRAMES reply frames for
+  * start_listen() to send, the last one flagged QUERY_LAST if the
+  * answer is complete; once all are out the query is done */
+ static void query_answer(void)
+ {
+   if(query_ready) return;              /* the last one is not out yet */
+   if(query_frames == QUERY_FRAMES || !query_more) {
+     EVLOG_INFO(EV_B_QUERY, radio_query.kind, radio_query.src_id,
+                query_skip - radio_query.skip, radio_query.skip);
+     query_pending = 0;
+     return;
+   }
+   uint8_t n = query_page(&radio_query, query_skip, &query_reply, &query_more);
+   query_len = proto_build_reply(&query_reply, node_id, radio_query.qid,
+                                 radio_query.kind,
+                                 query_more ? 0 : QUERY_LAST, query_skip, n);
+   query_skip += n;
+   query_frames++;
+   query_ready = 1;
+ }
+ 
+ /* rebuild the index from the newest logged sets */
+ static void query_init(void)
+ {
+   setlog_hdr_t h;
+   uint32_t next = setlog_next_seq();
+ 
+   setidx_init();
+   setlog_first(&log_it, next > SETIDX_SIZE ? next - SETIDX_SIZE : 0);
+   while(setlog_next(&log_it, &h, log_light, log_motion, log_dt)) {
+     setidx_add(h.seq, h.origin, 0, 0, h.n, log_light, log_motion);
+   }
+ }
+ 
+ /* "SETS|HOURLY <sender|*> [span [skip]]" */
+ static uint8_t query_parse(const char *line, query_pkt_t *q)
+ {
+   char *end;
+ 
+   if(strncmp(line, "SETS", 4) == 0) {
+     q->kind = QUERY_SETS;
+     line += 4;
+   } else if(strncmp(line, "HOURLY", 6) == 0) {
+     q->kind = QUERY_HOURLY;
+     line += 6;
+   } else {
+     return 0;
+   }
+   while(*line == ' ') line++;
+   if(*line == '*' || *line == '\0') {
+     q->sender = QUERY_ANY;
+     if(*line) line++;
+   } else {
+     q->sender = strtoul(line, &end, 10);
+     line = end;
+   }
+   q->span = strtoul(line, &end, 10);
+   q->skip = strtoul(end, NULL, 10);
+   q->src_id = 0;
+   q->qid    = 0;
+   return 1;
+ }
+ 
+ static uint8_t query_step(void)
+ {
+   static reply_pkt_t page;
+   char    head[48];
+   uint8_t more;
+   uint8_t n = query_page(&serial_query, serial_query.skip, &page, &more);
+ 
+   for(uint8_t i = 0; i < n; i++) {
+     if(serial_query.kind == QUERY_SETS) {
+       const query_set_rec_t *e = &page.set[i];
+       long age = e->age == QUERY_AGE_UNKNOWN ? -1 : (long)e->age;
+       snprintf(head, sizeof(head), "QS,%lu,%u,%ld,%d,%d",
+                (unsigned long)e->seq, e->origin, age, e->light, e->motion);
+     } else {
+       const query_hour_rec_t *e = &page.hour[i];
+       snprintf(head, sizeof(head), "QH,%u,%u,%u,%d,%d", e->origin,
+                e->hour, e->count, e->light, e->motion);
+     }
+     line_print(head, 0, NULL, NULL, NULL);
+   }
+   serial_lines      += n;
+   serial_query.skip += n;
+   if(more) return 1;
+   snprintf(head, sizeof(head), "QEND,%u", serial_lines);
+   line_print(head, 0, NULL, NULL, NULL);
+   EVLOG_INFO(EV_B_QUERY, serial_query.kind, 0, serial_lines,
+              serial_query.skip - serial_lines);
+   return 0;
+ }
+ #endif
+ 
+ #if SET_LOG
+ /* "DUMP [seq]", or a query */
+ static void serial_command(const char *line)
+ {
+   if(serial_job != JOB_NONE) return;
+   if(strncmp(line, "DUMP", 4) == 0) {
+     setlog_first(&log_it, strtoul(line + 4, NULL, 10));
+     serial_job = JOB_DUMP;
+     EVLOG_INFO(EV_B_LOG_DUMP, log_it.from);
+ #if QUERY_MODE
+   } else if(query_parse(line, &serial_query)) {
+     serial_job = JOB_QUERY;
+ #endif
+   } else {
+     return;
+   }
+   serial_lines = 0;
+   process_post(&node_b_process, PROCESS_EVENT_CONTINUE, NULL);
+ }
+ 
+ /* print one record; 0 (and the closing line) once the log is through */
+ static uint8_t log_dump_step(void)
+ {
+   setlog_hdr_t h;
+   char head[48];
+ 
+   if(setlog_next(&log_it, &h, log_light, log_motion, log_dt)) {
+     long age = h.boot == setlog_boot() ? (long)(clock_seconds() - h.t) : -1;
+     snprintf(head, sizeof(head), "LOG,%lu,%ld,%u,%u,%u,%u,",
+              (unsigned long)h.seq, age, h.origin, h.collector, h.set_no, h.n);
+     line_print(head, h.n, log_light, log_motion, log_dt);
+     serial_lines++;
+     return 1;
+   }
+   snprintf(head, sizeof(head), "END,%u,%lu", serial_lines,
+            (unsigned long)setlog_next_seq());
+   line_print(head, 0, NULL, NULL, NULL);
+   EVLOG_INFO(EV_B_LOG_DONE, serial_lines);
+   return 0;
+ }
+ 
+ /* one page of the running serial job; 0 once it is done */
+ static uint8_t serial_step(void)
+ {
+   uint8_t more = 0;
+ 
+   if(serial_job == JOB_DUMP) more = log_dump_step();
+ #if QUERY_MODE
+   else if(serial_job == JOB_QUERY) more = query_step();
+ #endif
+   if(!more) serial_job = JOB_NONE;
+   return more;
+ }
+ #endif
+ 
+ #if RELAY_MODE
+ /* ------------ relay: receiving side ------------ */
+ static void send_relay_ack(void)
+ {
+   static block_ack_pkt_t back;
+   relay_pending = 0;
+   nullnet_buf = (uint8_t *)&back;
+   nullnet_len = proto_build_block_ack(&back, node_id, relay_rx_map,
+                                       relay_rx_heard);
+   NETSTACK_NETWORK.output(&relay_child);
+   EVLOG_DBG(EV_B_RELAY_ACK, relay_rx_batch, relay_rx_map);
+ }
+ 
+ /* ------------ relay: forwarding side ------------ */
+ #if RELAY_FORWARD
+ static void rt_relay_probe(struct rtimer *t, void *ptr);
+ static void rt_relay_burst(struct rtimer *t, void *ptr);
+ static void rt_relay_timeout(struct rtimer *t, void *ptr);
+ 
+ static void relay_send(uint8_t idx, uint8_t flags)
+ {
+   static relay_pkt_t pkt;
+   nullnet_buf = (uint8_t *)&pkt;
+   nullnet_len = relay_frame(&pkt, node_id, relay_batch_no, idx, flags);
+   NETSTACK_NETWORK.output(&relay_parent);
+ }
+ 
+ /* first frame ≥ from the parent has not confirmed */
+ static uint8_t relay_next(uint8_t from)
+ {
+   while(from < relay_frames && (relay_map & (1 << from))) from++;
+   return from;
+ }
+ 
+ /* hop transfer over (wait: backoff after a failure, 0 on success):
+  * back to the listen cycle, the process re‑arms relay_timer */
+ static void relay_end(rtimer_clock_t wait)
+ {
+   relay_busy  = 0;
+   relay_wait  = wait;
+   relay_ended = 1;
+   NETSTACK_RADIO.off();
+   slot_sched_start(&sched, SLEEP_INTERVAL, start_listen, NULL);
+   process_poll(&node_b_process);
+ }
+ 
+ static void relay_failed(void)
+ {
+   EVLOG_WARN(EV_B_RELAY_FAIL, relay_batch_no, relay_map, relay_frames);
+   relay_abort();                    /* sets go out again in a later batch */
+   relay_end(retry_backoff(&relay_retry));
+ }
+ 
+ /* frame 0 every RELAY_STROBE until one lands in the parent's window */
+ static void rt_relay_probe(struct rtimer *t, void *ptr)
+ {
+   if(relay_strobe_left == 0) { relay_failed(); return; }
+   relay_strobe_left--;
+   NETSTACK_RADIO.on();
+   relay_send(0, PROTO_RELAY_PROBE);
+   slot_sched_next(&sched, RELAY_STROBE, rt_relay_probe, NULL);
+ }
+ 
+ /* the frames the parent lacks, back to back; the last asks for the ACK */
+ static void rt_relay_burst(struct rtimer *t, void *ptr)
+ {
+   uint8_t nxt = relay_next(relay_idx + 1);
+   relay_send(relay_idx, nxt >= relay_frames ? PROTO_RELAY_LAST : 0);
+   if(nxt < relay_frames) {
+     relay_idx = nxt;
+     slot_sched_next(&sched, RELAY_BURST_GAP, rt_relay_burst, NULL);
+   } else {
+     slot_sched_next(&sched, RELAY_ACK_WAIT, rt_relay_timeout, NULL);
+   }
+ }
+ 
+ /* no ACK after a burst: strobe again, RELAY_ROUNDS at most */
+ static void rt_relay_timeout(struct rtimer *t, void *ptr)
+ {
+   if(++relay_round >= RELAY_ROUNDS) { relay_failed(); return; }
+   relay_strobe_left = RELAY_STROBE_TRIES;
+   slot_sched_next(&sched, RELAY_STROBE, rt_relay_probe, NULL);
+ }
+ 
+ /* PKT_BLOCK_ACK from the parent */
+ static void relay_acked(uint16_t map)
+ {
+   relay_map |= map;
+   relay_idx = relay_next(0);
+   if(relay_idx < relay_frames) {
+     slot_sched_start(&sched, RELAY_BURST_GAP, rt_relay_burst, NULL);
+     return;
+   }
+   EVLOG_INFO(EV_B_RELAY_SENT, relay_batch_no, relay_frames / RELAY_SET_FRAMES,
+              relay_round + 1, relay_dropped());
+   relay_done();
+   retry_reset(&relay_retry);
+   relay_end(0);
+ }
+ 
+ /* process context: start a hop transfer once enough is queued */
+ static void relay_try(void)
+ {
+   unsigned long age;
+   uint8_t ready = relay_ready(&age);
+ 
+   if(relay_busy || back_pending || relay_pending) return;
+   if(ready == 0 || (ready < RELAY_BATCH && age < RELAY_MAX_AGE)) return;
+   if(!retry_take(&relay_retry, RELAY_COST_MS)) return;
+ 
+   relay_frames = relay_batch(RELAY_BATCH_MAX);
+   relay_batch_no++;
+   relay_map   = 0;
+   relay_idx   = 0;
+   relay_round = 0;
+   relay_strobe_left = RELAY_STROBE_TRIES;
+   relay_busy  = 1;
+   slot_sched_start(&sched, SLOT_SCHED_GUARD, rt_relay_probe, NULL);
+ }
+ #endif /* RELAY_FORWARD */
+ #endif /* RELAY_MODE */
+ 
+ /* all samples in: rebuild the sample times and start the next set */
+ static void set_complete(void)
+ {
+   /* fixed 1 Hz unless the set carried deltas */
+   t_off_buf[0] = 0;
+   for(uint8_t i = 1; i < SAMPLES; i++) {
+     t_off_buf[i] = t_off_buf[i - 1] +
+                    (has_ts ? dt_buf[i] : 1000 / PROTO_TICK_MS);
+   }
+   EVLOG_INFO(EV_B_SET_DONE, SAMPLES,
+              (long)t_off_buf[SAMPLES - 1] * PROTO_TICK_MS);
+   if(!has_ts) {
+     for(uint8_t i = 0; i < SAMPLES; i++) dt_buf[i] = i ? 1000 / PROTO_TICK_MS : 0;
+   }
+ #if RELAY_FORWARD
+   if(relay_put(set_origin, node_id, set_no, light_buf, motion_buf,
+                dt_buf) == NULL) {
+     EVLOG_WARN(EV_B_RELAY_FULL, set_origin);
+   }
+ #elif SET_OUT
+   set_out(set_origin, node_id, set_no, light_buf, motion_buf, dt_buf);
+ #endif
+   set_no++;
+   samples_rx = 0;
+ #if PROTO_BLOCK_ACK
+   parity_n  = 0;
+   parity_ok = 0;       /* parity still in flight belongs to this set */
+ #endif
  }
  
  /* ------------ Nullnet input ------------ */
  static void input_callback(const void *data, uint16_t len,
                             const linkaddr_t *src, const linkaddr_t *dest)
  {
-   if(len == 0) return;
-   uint8_t type = ((uint8_t *)data)[0];
+   static ack_pkt_t ack;
+   uint8_t type = proto_type(data, len);
  
-   if(type == PKT_REQUEST && len == sizeof(req_pkt_t)) {
-     if(abs(read_motion()) < MOTIONLESS_THRESHOLD) {
-       ack_pkt_t ra = { PKT_REQ_ACK, node_id, 0 };
-       nullnet_buf = (uint8_t *)&ra;
-       nullnet_len = sizeof(ra);
+ #if QUERY_MODE
+   if(proto_mgmt_type(data, len) == MGMT_QUERY) {
+     const query_pkt_t *q = proto_query_view(data, len);
+     if(q == NULL || query_pending) return;    /* the requester retries */
+     memcpy(&radio_query, q, sizeof(radio_query));
+     linkaddr_copy(&query_from, src);
+     query_skip    = q->skip;
+     query_more    = 1;
+     query_frames  = 0;
+     query_pending = 1;
+     process_poll(&node_b_process);
+     return;
+   }
+ #endif
+   if(type == PKT_ALERT) {
+     const alert_pkt_t *alert = proto_alert_view(data, len);
+     if(alert == NULL) return;
+ 
+     nullnet_buf = (uint8_t *)&ack;
+     nullnet_len = proto_build_ack(&ack, PKT_ALERT_ACK, node_id, alert->seq);
+     NETSTACK_NETWORK.output(src);
+ 
+     if(alert->seq != last_alert) {
+       last_alert = alert->seq;
+       EVLOG_ERR(EV_B_ALERT, clock_seconds(), alert->src_id, alert->motion,
+                 alert->seq);
+       evlog_kick();
+     }
+ 
+   } else if(type == PKT_REQUEST && proto_req_view(data, len) != NULL) {
+     if(abs(sensor_src_motion()) < MOTIONLESS_THRESHOLD) {
+ #if TDMA_MODE
+       static slot_ack_pkt_t sack;
+       uint16_t id = proto_req_view(data, len)->src_id;
+       uint8_t  s  = tdma_grant(id);
+       if(s < TDMA_SLOTS) {
+         nullnet_buf = (uint8_t *)&sack;
+         nullnet_len = proto_build_slot_ack(&sack, node_id, s + 1,
+                                            TICKS_MS(tdma_wait(s)),
+                                            TICKS_MS(TDMA_CYCLES * CYCLE),
+                                            TICKS_MS(CYCLE));
+         NETSTACK_NETWORK.output(src);
+         EVLOG_DBG(EV_B_SLOT_ACK, s + 1, id);
+         return;
+       }
+       EVLOG_DBG(EV_B_SLOT_FULL, id);
+ #endif
+       nullnet_buf = (uint8_t *)&ack;
+       nullnet_len = proto_build_ack(&ack, PKT_REQ_ACK, node_id, 0);
        NETSTACK_NETWORK.output(src);
-       printf("TX REQ_ACK (motionless)\n");
+       EVLOG_DBG(EV_B_REQ_ACK);
      } else {
-       printf("Ignore REQ – moving\n");
+       EVLOG_DBG(EV_B_REQ_MOVING);
      }
  
-   } else if(type == PKT_DATA && len == sizeof(data_pkt_t)) {
-     data_pkt_t pkt;
-     memcpy(&pkt, data, len);
-     uint8_t seq = pkt.seq;
-     printf("RX DATA chunk %u\n", seq);
+ #if DISC_MODE
+   } else if(type == PKT_BEACON && proto_disc_view(data, len) != NULL) {
+     static disc_pkt_t answer;
+     const disc_pkt_t *disc = proto_disc_view(data, len);
+     int16_t  rssi = (int16_t)packetbuf_attr(PACKETBUF_ATTR_RSSI);
+     rtimer_clock_t in = RTIMER_NOW() - win_at;
+     uint16_t wait = 0;
  
-     for(uint8_t i = 0; i < CHUNK_SIZE; i++) {
-       light_buf[seq * CHUNK_SIZE + i]  = pkt.payload[2*i];
-       motion_buf[seq * CHUNK_SIZE + i] = pkt.payload[2*i + 1];
+     if(disc->flags & PROTO_DISC_ACK) return;
+     if(abs(sensor_src_motion()) >= MOTIONLESS_THRESHOLD) {
+       EVLOG_DBG(EV_B_REQ_MOVING);
+       return;
      }
-     chunks_rx |= (1 << seq);
+     if(disc->flags & PROTO_DISC_SET) {
+       /* window held past WAKE_TIME: busy, the tag's next round retries */
+       if(in >= WAKE_TIME) return;
+       wait = TICKS_MS(CYCLE - in);
+     }
+     nullnet_buf = (uint8_t *)&answer;
+     nullnet_len = proto_build_disc(&answer, node_id, disc->seq,
+                                    PROTO_DISC_ACK, (int8_t)rssi, wait);
+     NETSTACK_NETWORK.output(src);
+     EVLOG_DBG(EV_B_DISC, disc->src_id, rssi, disc->flags, wait);
+ #endif
+ 
+   } else if(type == PKT_RUN || type == PKT_RUN_TS) {
+     uint8_t n;
+     const run_pkt_t *run = proto_run_view(data, len, &n);
+     if(run == NULL || run->off + n > SAMPLES) return;
+     uint8_t off = run->off;
+     EVLOG_INFO(EV_B_RX_DATA, off, n);
+ #if TDMA_MODE
+     tdma_heard(run->src_id);
+     if(samples_rx && run->src_id != set_origin) {
+       /* the last slot's owner left its set unfinished */
+       EVLOG_INFO(EV_B_SET_DROP, set_origin, run->src_id);
+       samples_rx = 0;
+       parity_n   = 0;
+     }
+ #endif
+ 
+     proto_run_unpack(run, n, &light_buf[off], &motion_buf[off], &dt_buf[off]);
+     has_ts = type == PKT_RUN_TS;
+     samples_rx |= run_mask(off, n);
+     set_origin = run->src_id;
  
+ #if PROTO_BLOCK_ACK
+     parity_ok = 1;
+     burst_frame(src);
+ #else
      /* send DATA_ACK */
-     ack_pkt_t da = { PKT_ACK, node_id, seq };
-     nullnet_buf = (uint8_t *)&da;
-     nullnet_len = sizeof(da);
+     nullnet_buf = (uint8_t *)&ack;
+     nullnet_len = proto_build_ack(&ack, PKT_ACK, node_id, off);
      NETSTACK_NETWORK.output(src);
-     printf("TX DATA_ACK %u\n", seq);
+     EVLOG_DBG(EV_B_DATA_ACK, off);
+ #endif
  
-     if(chunks_rx == 0x07) {
-       printf("Full set received - 60 samples stored\n");
-       chunks_rx = 0;
+     if(samples_rx == SET_MASK) set_complete();
+ 
+ #if PROTO_BLOCK_ACK
+   } else if(type == PKT_PARITY || type == PKT_PARITY_TS) {
+     uint8_t n;
+     const run_pkt_t *par = proto_run_view(data, len, &n);
+     if(par == NULL || !parity_ok || SAMPLES % n ||
+        PROTO_PARITY_STRIDE(par->off) == 0) {
+       return;
+     }
+ 
+     uint8_t p = 0;
+     while(p < parity_n && (parity[p].pkt.off != par->off || parity[p].n != n)) p++;
+     if(p == PARITY_SLOTS) p = PARITY_SLOTS - 1;     /* keep the newest */
+     else if(p == parity_n) parity_n++;
+     memcpy(&parity[p].pkt, par, len);
+     parity[p].n = n;
+ 
+     burst_frame(src);
+ #if TDMA_MODE
+     tdma_heard(par->src_id);
+ #endif
+     if(samples_rx == SET_MASK) set_complete();
+ #endif
+ 
+ #if RELAY_MODE
+   } else if(type == PKT_RELAY) {
+     uint8_t n;
+     relay_set_t *set;
+     const relay_pkt_t *pkt = proto_relay_view(data, len, &n);
+     if(pkt == NULL) return;
+ 
+     if(pkt->batch != relay_rx_batch || !linkaddr_cmp(src, &relay_child)) {
+       relay_rx_batch = pkt->batch;     /* a new batch from this child */
+       relay_rx_map   = 0;
+       relay_rx_heard = 0;
+       linkaddr_copy(&relay_child, src);
+     }
+     relay_rx_heard++;
+     uint8_t r = relay_rx(pkt, n, &set);
+     if(r != RELAY_RX_FULL) relay_rx_map |= 1 << PROTO_RELAY_IDX(pkt->idx);
+     if(r == RELAY_RX_COMPLETE) {
+ #if RELAY_FORWARD
+       EVLOG_DBG(EV_B_RELAY_QUEUED, set->origin, set->collector, set->set_no);
+ #else
+       uint16_t span = 0;
+       for(uint8_t i = 1; i < SAMPLES; i++) span += set->dt[i];
+       EVLOG_INFO(EV_B_RELAY_SET, set->set_no, set->origin, set->collector,
+                  (long)span * PROTO_TICK_MS);
+ #if SET_OUT
+       set_out(set->origin, set->collector, set->set_no, set->light,
+               set->motion, set->dt);
+ #endif
+       relay_release(set);
+ #endif
+     }
+ 
+     if(pkt->idx & (PROTO_RELAY_PROBE | PROTO_RELAY_LAST)) send_relay_ack();
+     if(!(pkt->idx & PROTO_RELAY_LAST)) {
+       relay_pending = 1;               /* more coming: ACK when quiet */
+       process_poll(&node_b_process);
+     }
+ 
+ #if RELAY_FORWARD
+   } else if(type == PKT_BLOCK_ACK) {
+     const block_ack_pkt_t *back = proto_block_ack_view(data, len);
+     if(back == NULL || !relay_busy || !linkaddr_cmp(src, &relay_parent)) return;
+     relay_acked(back->map);
+ #endif
+ #endif
+ 
+   } else if(type == PKT_SUMMARY) {
+     const summary_pkt_t *sum = proto_summary_view(data, len);
+     if(sum == NULL) return;
+ 
+     if(sum->seq != last_summary) {
+       last_summary = sum->seq;
+       EVLOG_INFO(EV_B_SUMMARY, sum->src_id, sum->n,
+                  (long)sum->span * PROTO_TICK_MS, sum->motion.peaks);
+       EVLOG_INFO(EV_B_SUM_LIGHT, sum->light.mean, sum->light.var,
+                  sum->light.min, sum->light.max);
+       EVLOG_INFO(EV_B_SUM_MOTION, sum->motion.mean, sum->motion.var,
+                  sum->motion.min, sum->motion.max);
      }
+ 
+     nullnet_buf = (uint8_t *)&ack;
+     nullnet_len = proto_build_ack(&ack, PKT_ACK, node_id, 0);
+     NETSTACK_NETWORK.output(src);
+     EVLOG_DBG(EV_B_DATA_ACK, 0);
    }
  }
  
@@ -139,16 +1124,80 @@
  {
    PROCESS_BEGIN();
  
+   evlog_init();
    nullnet_set_input_callback(input_callback);
-   SENSORS_ACTIVATE(mpu_9250_sensor);
+   sensor_src_init();
  
    /* start duty‑cycled listening */
    NETSTACK_RADIO.off();
-   rtimer_set(&rt, RTIMER_NOW() + RTIMER_SECOND / 20, 0,
-              start_listen, NULL);
+   slot_sched_start(&sched, RTIMER_SECOND / 20, start_listen, NULL);
+ 
+ #if RI_MODE
+   etimer_set(&motion_timer, MOTION_CHECK_INTERVAL);
+ #endif
+ #if RELAY_MODE
+   relay_init();
+ #endif
+ #if SET_LOG
+   if(setlog_init() == 0) {
+     EVLOG_INFO(EV_B_LOG_MOUNT, setlog_next_seq(), setlog_boot());
+   } else {
+     EVLOG_ERR(EV_B_LOG_FAIL);
+   }
+ #endif
+ #if QUERY_MODE
+   query_init();
+ #endif
+ #if RELAY_FORWARD
+   retry_init(&relay_retry);
+   etimer_set(&relay_timer, RELAY_CHECK);
+ #endif
  
    while(1) {
-     PROCESS_YIELD();   /* nothing else to do */
+     PROCESS_WAIT_EVENT();
+ 
+ #if PROTO_BLOCK_ACK
+     if(ev == PROCESS_EVENT_POLL) {
+       /* another frame of the burst: restart the quiet‑time timer */
+       etimer_set(&block_ack_timer, BLOCK_ACK_DELAY);
+     } else if(ev == PROCESS_EVENT_TIMER && data == &block_ack_timer) {
+       if(back_pending) send_block_ack();
+ #if RELAY_MODE
+       if(relay_pending) send_relay_ack();
+ #endif
+     }
+ #endif
+ #if RELAY_FORWARD
+     if(ev == PROCESS_EVENT_POLL && relay_ended) {
+       /* hop transfer over: next look after its backoff */
+       relay_ended = 0;
+       etimer_set(&relay_timer, relay_wait == 0 ? RELAY_CHECK :
+                  (clock_time_t)((uint64_t)relay_wait * CLOCK_SECOND / RTIMER_SECOND) + 1);
+     } else if(ev == PROCESS_EVENT_TIMER && data == &relay_timer) {
+       relay_try();
+       if(!relay_busy) etimer_set(&relay_timer, RELAY_CHECK);
+     }
+ #endif
+ #if SET_OUT
+     if(ev == PROCESS_EVENT_POLL && out_tail != out_head) out_flush();
+ #endif
+ #if SET_LOG
+     if(ev == serial_line_event_message) {
+       serial_command((const char *)data);
+     } else if(ev == PROCESS_EVENT_CONTINUE && serial_job != JOB_NONE &&
+               serial_step()) {
+       process_post(&node_b_process, PROCESS_EVENT_CONTINUE, NULL);
+     }
+ #endif
+ #if QUERY_MODE
+     if(ev == PROCESS_EVENT_POLL && query_pending) query_answer();
+ #endif
+ #if RI_MODE
+     if(ev == PROCESS_EVENT_TIMER && data == &motion_timer) {
+       motionless = abs(sensor_src_motion()) < MOTIONLESS_THRESHOLD;
+       etimer_reset(&motion_timer);
+     }
+ #endif
    }
  
    PROCESS_END();
@@ -0,0 +1,383 @@
+/*
+ * protocol.c – Frame parsing / building helpers (see protocol.h)
+ */
+
+#include <stddef.h>
+#include <string.h>
+#include <stdint.h>
+#include "protocol.h"
+
+/* ------------ receive side ------------ */
+uint8_t proto_type(const void *data, uint16_t len)
+{
+  if(len == 0) return 0;
+  uint8_t hdr = ((const uint8_t *)data)[0];
+  if((hdr >> 4) != PROTO_VERSION) return 0;
+  return hdr & 0x0F;
+}
+
+const req_pkt_t *proto_req_view(const void *data, uint16_t len)
+{
+  uint8_t type = proto_type(data, len);
+  if(len != sizeof(req_pkt_t)) return NULL;
+  if(type != PKT_REQUEST && type != PKT_BEACON) return NULL;
+  return (const req_pkt_t *)data;
+}
+
+const ack_pkt_t *proto_ack_view(const void *data, uint16_t len)
+{
+  uint8_t type = proto_type(data, len);
+  if(type == PKT_REQ_ACK && len == sizeof(slot_ack_pkt_t)) {
+    return (const ack_pkt_t *)data;          /* same leading fields */
+  }
+  if(len != sizeof(ack_pkt_t)) return NULL;
+  if(type != PKT_ACK && type != PKT_REQ_ACK && type != PKT_ALERT_ACK) {
+    return NULL;
+  }
+  return (const ack_pkt_t *)data;
+}
+
+const slot_ack_pkt_t *proto_slot_ack_view(const void *data, uint16_t len)
+{
+  if(len != sizeof(slot_ack_pkt_t)) return NULL;
+  if(proto_type(data, len) != PKT_REQ_ACK) return NULL;
+  const slot_ack_pkt_t *sack = (const slot_ack_pkt_t *)data;
+  if(sack->period_ms == 0 || sack->len_ms > sack->period_ms ||
+     sack->len_ms <= PROTO_SLOT_BURST_MS + PROTO_SLOT_GUARD_MS) {
+    return NULL;
+  }
+  return sack;
+}
+
+const disc_pkt_t *proto_disc_view(const void *data, uint16_t len)
+{
+  if(len != sizeof(disc_pkt_t)) return NULL;
+  if(proto_type(data, len) != PKT_BEACON) return NULL;
+  return (const disc_pkt_t *)data;
+}
+
+const data_pkt_t *proto_data_view(const void *data, uint16_t len)
+{
+  if(len != sizeof(data_pkt_t)) return NULL;
+  if(proto_type(data, len) != PKT_DATA) return NULL;
+  return (const data_pkt_t *)data;
+}
+
+const data_ts_pkt_t *proto_data_ts_view(const void *data, uint16_t len)
+{
+  if(len != sizeof(data_ts_pkt_t)) return NULL;
+  if(proto_type(data, len) != PKT_DATA_TS) return NULL;
+  return (const data_ts_pkt_t *)data;
+}
+
+const summary_pkt_t *proto_summary_view(const void *data, uint16_t len)
+{
+  if(len != sizeof(summary_pkt_t)) return NULL;
+  if(proto_type(data, len) != PKT_SUMMARY) return NULL;
+  return (const summary_pkt_t *)data;
+}
+
+const alert_pkt_t *proto_alert_view(const void *data, uint16_t len)
+{
+  if(len != sizeof(alert_pkt_t)) return NULL;
+  if(proto_type(data, len) != PKT_ALERT) return NULL;
+  return (const alert_pkt_t *)data;
+}
+
+const block_ack_pkt_t *proto_block_ack_view(const void *data, uint16_t len)
+{
+  if(len != sizeof(block_ack_pkt_t)) return NULL;
+  if(proto_type(data, len) != PKT_BLOCK_ACK) return NULL;
+  return (const block_ack_pkt_t *)data;
+}
+
+const run_pkt_t *proto_run_view(const void *data, uint16_t len, uint8_t *n)
+{
+  uint8_t type = proto_type(data, len);
+  uint8_t rec;
+
+  if(type == PKT_RUN || type == PKT_PARITY) rec = sizeof(run_rec_t);
+  else if(type == PKT_RUN_TS || type == PKT_PARITY_TS) rec = sizeof(run_rec_ts_t);
+  else return NULL;
+  if(len <= PROTO_RUN_HDR_LEN || (len - PROTO_RUN_HDR_LEN) % rec) return NULL;
+  if((len - PROTO_RUN_HDR_LEN) / rec > PROTO_RUN_MAX) return NULL;
+  *n = (len - PROTO_RUN_HDR_LEN) / rec;
+  return (const run_pkt_t *)data;
+}
+
+const relay_pkt_t *proto_relay_view(const void *data, uint16_t len,
+                                    uint8_t *n)
+{
+  if(proto_type(data, len) != PKT_RELAY) return NULL;
+  if(len <= PROTO_RELAY_HDR_LEN) return NULL;
+  if((len - PROTO_RELAY_HDR_LEN) % sizeof(run_rec_ts_t)) return NULL;
+  if((len - PROTO_RELAY_HDR_LEN) / sizeof(run_rec_ts_t) > PROTO_RELAY_RUN) {
+    return NULL;
+  }
+  *n = (len - PROTO_RELAY_HDR_LEN) / sizeof(run_rec_ts_t);
+  return (const relay_pkt_t *)data;
+}
+
+uint8_t proto_mgmt_type(const void *data, uint16_t len)
+{
+  if(len == 0) return 0;
+  uint8_t hdr = ((const uint8_t *)data)[0];
+  if((hdr >> 4) != PROTO_MGMT) return 0;
+  return hdr & 0x0F;
+}
+
+const query_pkt_t *proto_query_view(const void *data, uint16_t len)
+{
+  if(len != sizeof(query_pkt_t)) return NULL;
+  if(proto_mgmt_type(data, len) != MGMT_QUERY) return NULL;
+  return (const query_pkt_t *)data;
+}
+
+const reply_pkt_t *proto_reply_view(const void *data, uint16_t len,
+                                    uint8_t *n)
+{
+  const reply_pkt_t *pkt = data;
+  uint8_t rec, max;
+
+  if(proto_mgmt_type(data, len) != MGMT_REPLY) return NULL;
+  if(len < PROTO_REPLY_HDR_LEN) return NULL;
+  if(pkt->kind == QUERY_SETS) {
+    rec = sizeof(query_set_rec_t);
+    max = PROTO_REPLY_SETS;
+  } else if(pkt->kind == QUERY_HOURLY) {
+    rec = sizeof(query_hour_rec_t);
+    max = PROTO_REPLY_HOURS;
+  } else {
+    return NULL;
+  }
+  if((len - PROTO_REPLY_HDR_LEN) % rec) return NULL;
+  if((len - PROTO_REPLY_HDR_LEN) / rec > max) return NULL;
+  *n = (len - PROTO_REPLY_HDR_LEN) / rec;
+  return pkt;
+}
+
+void proto_data_unpack(const data_pkt_t *pkt,
+                       int16_t *light, int16_t *motion)
+{
+  for(uint8_t i = 0; i < PROTO_CHUNK_SIZE; i++) {
+    light[i]  = pkt->payload[2*i];
+    motion[i] = pkt->payload[2*i + 1];
+  }
+}
+
+void proto_run_unpack(const run_pkt_t *pkt, uint8_t n,
+                      int16_t *light, int16_t *motion, uint8_t *dt)
+{
+  uint8_t type = proto_type(pkt, PROTO_RUN_HDR_LEN);
+  uint8_t ts   = type == PKT_RUN_TS || type == PKT_PARITY_TS;
+
+  for(uint8_t i = 0; i < n; i++) {
+    light[i]  = ts ? pkt->rec_ts[i].light  : pkt->rec[i].light;
+    motion[i] = ts ? pkt->rec_ts[i].motion : pkt->rec[i].motion;
+    if(dt != NULL) dt[i] = ts ? pkt->rec_ts[i].dt : 0;
+  }
+}
+
+/* ------------ transmit side ------------ */
+uint16_t proto_build_req(req_pkt_t *pkt, uint8_t type, uint16_t src_id)
+{
+  pkt->hdr    = PROTO_HDR(type);
+  pkt->src_id = src_id;
+  return sizeof(*pkt);
+}
+
+uint16_t proto_build_ack(ack_pkt_t *pkt, uint8_t type, uint16_t src_id,
+                         uint8_t seq)
+{
+  pkt->hdr    = PROTO_HDR(type);
+  pkt->src_id = src_id;
+  pkt->seq    = seq;
+  return sizeof(*pkt);
+}
+
+uint16_t proto_build_slot_ack(slot_ack_pkt_t *pkt, uint16_t src_id,
+                              uint8_t slot, uint16_t wait_ms,
+                              uint16_t period_ms, uint16_t len_ms)
+{
+  pkt->hdr       = PROTO_HDR(PKT_REQ_ACK);
+  pkt->src_id    = src_id;
+  pkt->seq       = 0;
+  pkt->slot      = slot;
+  pkt->wait_ms   = wait_ms;
+  pkt->period_ms = period_ms;
+  pkt->len_ms    = len_ms;
+  return sizeof(*pkt);
+}
+
+uint16_t proto_build_disc(disc_pkt_t *pkt, uint16_t src_id, uint8_t seq,
+                          uint8_t flags, int8_t rssi, uint16_t wait_ms)
+{
+  pkt->hdr     = PROTO_HDR(PKT_BEACON);
+  pkt->src_id  = src_id;
+  pkt->seq     = seq;
+  pkt->flags   = flags;
+  pkt->rssi    = rssi;
+  pkt->wait_ms = wait_ms;
+  return sizeof(*pkt);
+}
+
+uint16_t proto_build_data(data_pkt_t *pkt, uint16_t src_id, uint8_t seq,
+                          const int16_t *light, const int16_t *motion)
+{
+  pkt->hdr    = PROTO_HDR(PKT_DATA);
+  pkt->src_id = src_id;
+  pkt->seq    = seq;
+  for(uint8_t i = 0; i < PROTO_CHUNK_SIZE; i++) {
+    pkt->payload[2*i]     = light[i];
+    pkt->payload[2*i + 1] = motion[i];
+  }
+  return sizeof(*pkt);
+}
+
+uint16_t proto_build_data_ts(data_ts_pkt_t *pkt, uint16_t src_id,
+                             uint8_t seq, const int16_t *light,
+                             const int16_t *motion, const uint16_t *t_off,
+                             uint16_t t_prev)
+{
+  pkt->hdr    = PROTO_HDR(PKT_DATA_TS);
+  pkt->src_id = src_id;
+  pkt->seq    = seq;
+  for(uint8_t i = 0; i < PROTO_CHUNK_SIZE; i++) {
+    uint16_t dt = t_off[i] - t_prev;
+    pkt->payload[2*i]     = light[i];
+    pkt->payload[2*i + 1] = motion[i];
+    pkt->dt[i]            = dt > 0xFF ? 0xFF : dt;
+    t_prev = t_off[i];
+  }
+  return sizeof(*pkt);
+}
+
+uint16_t proto_build_run(run_pkt_t *pkt, uint16_t src_id, uint8_t off,
+                         uint8_t n, const int16_t *light,
+                         const int16_t *motion, const uint16_t *t_off,
+                         uint16_t t_prev)
+{
+  pkt->hdr    = PROTO_HDR(t_off != NULL ? PKT_RUN_TS : PKT_RUN);
+  pkt->src_id = src_id;
+  pkt->off    = off;
+  for(uint8_t i = 0; i < n; i++) {
+    if(t_off != NULL) {
+      uint16_t dt = t_off[i] - t_prev;
+      pkt->rec_ts[i].light  = light[i];
+      pkt->rec_ts[i].motion = motion[i];
+      pkt->rec_ts[i].dt     = dt > 0xFF ? 0xFF : dt;
+      t_prev = t_off[i];
+    } else {
+      pkt->rec[i].light  = light[i];
+      pkt->rec[i].motion = motion[i];
+    }
+  }
+  return PROTO_RUN_HDR_LEN +
+         n * (t_off != NULL ? sizeof(run_rec_ts_t) : sizeof(run_rec_t));
+}
+
+uint16_t proto_build_block_ack(block_ack_pkt_t *pkt, uint16_t src_id,
+                               uint16_t map, uint8_t heard)
+{
+  pkt->hdr    = PROTO_HDR(PKT_BLOCK_ACK);
+  pkt->src_id = src_id;
+  pkt->map    = map;
+  pkt->heard  = heard;
+  return sizeof(*pkt);
+}
+
+uint16_t proto_build_parity(run_pkt_t *pkt, uint16_t src_id, uint8_t group,
+                            uint8_t n, uint8_t ts)
+{
+  memset(pkt, 0, sizeof(*pkt));
+  pkt->hdr    = PROTO_HDR(ts ? PKT_PARITY_TS : PKT_PARITY);
+  pkt->src_id = src_id;
+  pkt->off    = group;
+  return PROTO_RUN_HDR_LEN +
+         n * (ts ? sizeof(run_rec_ts_t) : sizeof(run_rec_t));
+}
+
+void proto_parity_add(run_pkt_t *pkt, const run_pkt_t *run, uint16_t len)
+{
+  /* records only, byte by byte: the layout is the same for both types */
+  uint8_t       *p = (uint8_t *)pkt;
+  const uint8_t *r = (const uint8_t *)run;
+
+  for(uint16_t i = PROTO_RUN_HDR_LEN; i < len; i++) p[i] ^= r[i];
+}
+
+uint16_t proto_build_relay(relay_pkt_t *pkt, uint16_t src_id, uint8_t batch,
+                           uint8_t idx, uint16_t origin, uint16_t collector,
+                           uint8_t set_no, uint8_t off, uint8_t n,
+                           const int16_t *light, const int16_t *motion,
+                           const uint8_t *dt)
+{
+  pkt->hdr       = PROTO_HDR(PKT_RELAY);
+  pkt->src_id    = src_id;
+  pkt->batch     = batch;
+  pkt->idx       = idx;
+  pkt->origin    = origin;
+  pkt->collector = collector;
+  pkt->set_no    = set_no;
+  pkt->off       = off;
+  for(uint8_t i = 0; i < n; i++) {
+    pkt->rec[i].light  = light[i];
+    pkt->rec[i].motion = motion[i];
+    pkt->rec[i].dt     = dt[i];
+  }
+  return PROTO_RELAY_HDR_LEN + n * sizeof(run_rec_ts_t);
+}
+
+uint16_t proto_build_query(query_pkt_t *pkt, uint16_t src_id, uint8_t qid,
+                           uint8_t kind, uint16_t sender, uint32_t span,
+                           uint16_t skip)
+{
+  pkt->hdr    = PROTO_MGMT_HDR(MGMT_QUERY);
+  pkt->src_id = src_id;
+  pkt->qid    = qid;
+  pkt->kind   = kind;
+  pkt->sender = sender;
+  pkt->span   = span;
+  pkt->skip   = skip;
+  return sizeof(*pkt);
+}
+
+uint16_t proto_build_reply(reply_pkt_t *pkt, uint16_t src_id, uint8_t qid,
+                           uint8_t kind, uint8_t flags, uint16_t first,
+                           uint8_t n)
+{
+  pkt->hdr    = PROTO_MGMT_HDR(MGMT_REPLY);
+  pkt->src_id = src_id;
+  pkt->qid    = qid;
+  pkt->kind   = kind;
+  pkt->flags  = flags;
+  pkt->first  = first;
+  return PROTO_REPLY_HDR_LEN + n * (kind == QUERY_SETS ?
+                                    sizeof(query_set_rec_t) :
+                                    sizeof(query_hour_rec_t));
+}
+
+uint16_t proto_build_alert(alert_pkt_t *pkt, uint16_t src_id, uint8_t seq,
+                           int16_t motion)
+{
+  pkt->hdr    = PROTO_HDR(PKT_ALERT);
+  pkt->src_id = src_id;
+  pkt->seq    = seq;
+  pkt->motion = motion;
+  return sizeof(*pkt);
+}
+
+uint16_t proto_build_summary(summary_pkt_t *pkt, uint16_t src_id,
+                             uint8_t seq, uint8_t n, uint16_t span,
+                             const feat_summary_t *light,
+                             const feat_summary_t *motion)
+{
+  pkt->hdr    = PROTO_HDR(PKT_SUMMARY);
+  pkt->src_id = src_id;
+  pkt->seq    = seq;
+  pkt->n      = n;
+  pkt->span   = span;
+  pkt->light  = *light;
+  pkt->motion = *motion;
+  return sizeof(*pkt);
+}
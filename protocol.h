@@ -0,0 +1,363 @@
+/*
+ * protocol.h – Node A / Node B frame formats (shared by all firmwares)
+ *
+ * Every frame starts with one header byte:
+ *      bits 7‑4  PROTO_VERSION
+ *      bits 3‑0  packet type (PKT_*)
+ * followed by the sender's node id.  Frames with another version or a
+ * wrong length are rejected by the proto_*_view() helpers.  Management
+ * frames (queries to Node B) use bits 7‑4 = PROTO_MGMT and their own
+ * type space, so data‑path receivers never see them.
+ *
+ * Receive paths never copy a frame: the views are pointers into the
+ * nullnet buffer (the structs are packed, so field access is byte‑wise
+ * and alignment safe) and proto_data_unpack() writes the payload
+ * straight into the caller's reassembly arrays.
+ */
+
+#ifndef PROTOCOL_H_
+#define PROTOCOL_H_
+
+#include <stdint.h>
+#include "feature.h"
+
+/* ------------ version / header ------------ */
+#define PROTO_VERSION        1
+#define PROTO_HDR(type)      ((uint8_t)((PROTO_VERSION << 4) | ((type) & 0x0F)))
+
+/* ------------ packet types ------------ */
+#define PKT_BEACON   0x01
+#define PKT_REQUEST  0x02
+#define PKT_DATA     0x03
+#define PKT_ACK      0x04
+#define PKT_REQ_ACK  0x05
+#define PKT_DATA_TS  0x06    /* PKT_DATA + per‑sample time deltas */
+#define PKT_SUMMARY  0x07    /* per‑set features instead of samples */
+#define PKT_ALERT    0x08    /* extreme motion, ahead of bulk data */
+#define PKT_ALERT_ACK 0x09
+#define PKT_BLOCK_ACK 0x0A   /* bitmap of a set's chunks received */
+#define PKT_PARITY   0x0B    /* XOR of several PKT_RUN frames */
+#define PKT_RUN      0x0C    /* samples at any offset of a set */
+#define PKT_RUN_TS   0x0D    /* PKT_RUN + per‑sample time deltas */
+#define PKT_PARITY_TS 0x0E   /* XOR of several PKT_RUN_TS frames */
+#define PKT_RELAY    0x0F    /* set run, Node B → Node B / sink (last type) */
+
+#define PROTO_CHUNK_SIZE     20    /* readings per PKT_DATA frame */
+#define PROTO_TICK_MS        100   /* unit of sample time offsets */
+#define PROTO_RUN_MAX        PROTO_CHUNK_SIZE  /* samples per PKT_RUN_TS */
+#define PROTO_SLICE          5     /* samples per PKT_BLOCK_ACK map bit */
+
+/* 1: data chunks are acknowledged by one PKT_BLOCK_ACK per burst instead
+ * of a PKT_ACK each (both ends must agree) */
+#ifdef PROTO_CONF_BLOCK_ACK
+#define PROTO_BLOCK_ACK      PROTO_CONF_BLOCK_ACK
+#else
+#define PROTO_BLOCK_ACK      1
+#endif
+
+/* ------------ packet formats ------------ */
+typedef struct __attribute__((packed)) {
+  uint8_t  hdr;
+  uint16_t src_id;
+} req_pkt_t;               /* PKT_REQUEST, also beacon */
+
+typedef struct __attribute__((packed)) {
+  uint8_t  hdr;
+  uint16_t src_id;
+  uint8_t  seq;
+} ack_pkt_t;               /* PKT_REQ_ACK, PKT_ACK or PKT_ALERT_ACK */
+
+/* PKT_REQ_ACK of a TDMA Node B: the sender owns transfer slot `slot`,
+ * len_ms long and repeating every period_ms, the next one starting
+ * wait_ms after this frame.  The owner sends its data only inside the
+ * slot and needs no new handshake while it holds it; a slot nobody
+ * used for PROTO_SLOT_LEASE seconds is given away.  Receivers that
+ * know only ack_pkt_t read it as a plain REQ_ACK.  A grant whose slot
+ * cannot hold the guard and a burst with its block ACK, or is longer
+ * than its period, is not taken as one. */
+#define PROTO_SLOT_LEASE     30
+#define PROTO_SLOT_GUARD_MS  5     /* owner starts this far into the slot */
+#define PROTO_SLOT_BURST_MS  100   /* burst + block ACK */
+
+typedef struct __attribute__((packed)) {
+  uint8_t  hdr;
+  uint16_t src_id;
+  uint8_t  seq;
+  uint8_t  slot;
+  uint16_t wait_ms;
+  uint16_t period_ms;
+  uint16_t len_ms;
+} slot_ack_pkt_t;
+
+/* discovery beacon (nbr.c style, broadcast) of a Node A and Node B's
+ * answer, both PKT_BEACON told apart from the plain one by length.  The
+ * exchange replaces the REQUEST handshake: rssi lets the tag check the
+ * link both ways at once and wait_ms names the rendezvous – the start
+ * of the listen window the set is to be sent in. */
+#define PROTO_DISC_SET       0x01  /* beacon: sender has a set to upload */
+#define PROTO_DISC_ACK       0x02  /* answer to the beacon seq */
+
+typedef struct __attribute__((packed)) {
+  uint8_t  hdr;
+  uint16_t src_id;
+  uint8_t  seq;
+  uint8_t  flags;          /* PROTO_DISC_* */
+  int8_t   rssi;           /* answer: beacon heard at, dBm */
+  uint16_t wait_ms;        /* answer: to the rendezvous, 0 for none */
+} disc_pkt_t;
+
+typedef struct __attribute__((packed)) {
+  uint8_t  hdr;
+  uint16_t src_id;
+  uint8_t  seq;            /* chunk number */
+  int16_t  payload[PROTO_CHUNK_SIZE * 2];   /* light, motion interleaved */
+} data_pkt_t;
+
+/* adaptive‑rate chunk: dt[i] is the gap to the previous sample of the
+ * set in PROTO_TICK_MS units (dt[0] of chunk 0 is 0).  104 bytes – the largest
+ * payload an 802.15.4 frame with long addresses can carry. */
+typedef struct __attribute__((packed)) {
+  uint8_t  hdr;
+  uint16_t src_id;
+  uint8_t  seq;
+  int16_t  payload[PROTO_CHUNK_SIZE * 2];
+  uint8_t  dt[PROTO_CHUNK_SIZE];
+} data_ts_pkt_t;
+
+/* one sample of a run; dt as in data_ts_pkt_t */
+typedef struct __attribute__((packed)) {
+  int16_t  light;
+  int16_t  motion;
+} run_rec_t;
+
+typedef struct __attribute__((packed)) {
+  int16_t  light;
+  int16_t  motion;
+  uint8_t  dt;
+} run_rec_ts_t;
+
+/* n consecutive samples of a set starting at sample off; the frame is
+ * only as long as its records, so n follows from the length and the
+ * sender can size frames to the link.
+ *
+ * PKT_PARITY / PKT_PARITY_TS reuse the layout: off holds the group
+ * (PROTO_PARITY_GROUP) and the records are the XOR of the runs
+ * c·n … c·n+n−1 for c = first, first+stride, … – a receiver missing one
+ * of those runs can rebuild it from the others. */
+typedef struct __attribute__((packed)) {
+  uint8_t  hdr;
+  uint16_t src_id;
+  uint8_t  off;
+  union {
+    run_rec_t    rec[PROTO_RUN_MAX];
+    run_rec_ts_t rec_ts[PROTO_RUN_MAX];
+  };
+} run_pkt_t;
+
+#define PROTO_RUN_HDR_LEN          4
+#define PROTO_PARITY_GROUP(f, s)   ((uint8_t)(((s) << 4) | ((f) & 0x0F)))
+#define PROTO_PARITY_FIRST(g)      ((g) & 0x0F)
+#define PROTO_PARITY_STRIDE(g)     ((g) >> 4)
+
+/* one run of a completed set on its way from relay to relay towards
+ * the sink (relay.h); idx is the frame's place in the hop batch and
+ * each hop acknowledges a batch with PKT_BLOCK_ACK, bit idx per frame */
+#define PROTO_RELAY_RUN      15    /* samples per PKT_RELAY */
+#define PROTO_RELAY_PROBE    0x80  /* idx flag: acknowledge right away */
+#define PROTO_RELAY_LAST     0x40  /* idx flag: end of burst, acknowledge */
+#define PROTO_RELAY_IDX(i)   ((i) & 0x1F)
+
+typedef struct __attribute__((packed)) {
+  uint8_t  hdr;
+  uint16_t src_id;         /* this hop's sender */
+  uint8_t  batch;          /* hop batch number, per sender */
+  uint8_t  idx;            /* frame in the batch | PROTO_RELAY_* flags */
+  uint16_t origin;         /* Node A that collected the set */
+  uint16_t collector;      /* Node B that received it from Node A */
+  uint8_t  set_no;         /* collector's set number */
+  uint8_t  off;            /* first sample of the run */
+  run_rec_ts_t rec[PROTO_RELAY_RUN];
+} relay_pkt_t;
+
+#define PROTO_RELAY_HDR_LEN  11
+
+/* cumulative: bit n set = samples n·PROTO_SLICE … of the current set are
+ * stored (or were rebuilt from parity); heard lets the sender estimate
+ * frame loss */
+typedef struct __attribute__((packed)) {
+  uint8_t  hdr;
+  uint16_t src_id;
+  uint16_t map;
+  uint8_t  heard;          /* frames received since the last block ACK */
+} block_ack_pkt_t;
+
+/* sent as soon as a reading crosses the alert threshold; acknowledged by
+ * PKT_ALERT_ACK with the same seq */
+typedef struct __attribute__((packed)) {
+  uint8_t  hdr;
+  uint16_t src_id;
+  uint8_t  seq;            /* alert number, for duplicate detection */
+  int16_t  motion;         /* triggering reading, centi‑g */
+} alert_pkt_t;
+
+/* summary of one set (feature.h), 45 bytes instead of three data frames.
+ * Acknowledged like chunk 0 of a set (PKT_ACK, seq 0). */
+typedef struct __attribute__((packed)) {
+  uint8_t  hdr;
+  uint16_t src_id;
+  uint8_t  seq;            /* set number, for duplicate detection */
+  uint8_t  n;              /* samples summarised */
+  uint16_t span;           /* first → last sample, PROTO_TICK_MS units */
+  feat_summary_t light;
+  feat_summary_t motion;
+} summary_pkt_t;
+
+/* ------------ management frames ------------ */
+#define PROTO_MGMT           2
+#define PROTO_MGMT_HDR(type) ((uint8_t)((PROTO_MGMT << 4) | ((type) & 0x0F)))
+
+#define MGMT_QUERY   0x01    /* pull request to Node B */
+#define MGMT_REPLY   0x02    /* up to PROTO_REPLY_* entries of the answer */
+
+#define QUERY_SETS       1   /* catalog of stored sets, query_set_rec_t */
+#define QUERY_HOURLY     2   /* per sender and hour means, query_hour_rec_t */
+#define QUERY_ANY        0xFFFF   /* sender: every Node A */
+#define QUERY_AGE_UNKNOWN 0xFFFFFFFFUL  /* logged before Node B's last reset */
+#define QUERY_LAST       0x01     /* reply flag: no entries after these */
+
+/* span: only sets logged in the last span seconds (0: all; QUERY_HOURLY
+ * covers span rounded up to hours).  Entries are numbered in a fixed
+ * order – oldest set first, or hour 0 (the last hour) first – and skip
+ * drops the first entries, so a requester that lost replies or got a
+ * reply without QUERY_LAST asks again from what it has. */
+typedef struct __attribute__((packed)) {
+  uint8_t  hdr;
+  uint16_t src_id;
+  uint8_t  qid;            /* echoed in the replies */
+  uint8_t  kind;           /* QUERY_* */
+  uint16_t sender;         /* Node A id or QUERY_ANY */
+  uint32_t span;
+  uint16_t skip;
+} query_pkt_t;
+
+typedef struct __attribute__((packed)) {
+  uint32_t seq;            /* set log record (setlog.h) */
+  uint16_t origin;
+  uint32_t age;            /* s since the set was logged */
+  int16_t  light;          /* means over the set */
+  int16_t  motion;
+} query_set_rec_t;
+
+typedef struct __attribute__((packed)) {
+  uint16_t origin;
+  uint8_t  hour;           /* 0: logged within the last hour */
+  uint8_t  count;          /* sets */
+  int16_t  light;          /* means over those sets */
+  int16_t  motion;
+} query_hour_rec_t;
+
+#define PROTO_REPLY_SETS     6
+#define PROTO_REPLY_HOURS    10
+
+typedef struct __attribute__((packed)) {
+  uint8_t  hdr;
+  uint16_t src_id;
+  uint8_t  qid;
+  uint8_t  kind;
+  uint8_t  flags;          /* QUERY_LAST */
+  uint16_t first;          /* number of entry set[0] / hour[0] */
+  union {
+    query_set_rec_t  set[PROTO_REPLY_SETS];
+    query_hour_rec_t hour[PROTO_REPLY_HOURS];
+  };
+} reply_pkt_t;
+
+#define PROTO_REPLY_HDR_LEN  8
+
+/* ------------ receive side (zero copy) ------------ */
+
+/* packet type of a frame, or 0 if it is empty or another version */
+uint8_t proto_type(const void *data, uint16_t len);
+
+/* length‑checked views into the received buffer; NULL if malformed */
+const req_pkt_t  *proto_req_view(const void *data, uint16_t len);
+const ack_pkt_t  *proto_ack_view(const void *data, uint16_t len);
+/* a PKT_REQ_ACK that carries a slot, NULL for a plain one */
+const slot_ack_pkt_t *proto_slot_ack_view(const void *data, uint16_t len);
+const disc_pkt_t *proto_disc_view(const void *data, uint16_t len);
+const data_pkt_t *proto_data_view(const void *data, uint16_t len);
+const data_ts_pkt_t *proto_data_ts_view(const void *data, uint16_t len);
+const summary_pkt_t *proto_summary_view(const void *data, uint16_t len);
+const alert_pkt_t   *proto_alert_view(const void *data, uint16_t len);
+const block_ack_pkt_t *proto_block_ack_view(const void *data, uint16_t len);
+/* PKT_RUN, PKT_RUN_TS or either parity type; *n = records in the frame */
+const run_pkt_t     *proto_run_view(const void *data, uint16_t len,
+                                    uint8_t *n);
+const relay_pkt_t   *proto_relay_view(const void *data, uint16_t len,
+                                      uint8_t *n);
+/* MGMT_* type of a management frame, 0 for anything else */
+uint8_t proto_mgmt_type(const void *data, uint16_t len);
+const query_pkt_t   *proto_query_view(const void *data, uint16_t len);
+/* *n = entries of the reply's kind */
+const reply_pkt_t   *proto_reply_view(const void *data, uint16_t len,
+                                      uint8_t *n);
+
+/* de‑interleave a data frame's PROTO_CHUNK_SIZE readings in place
+ * (data_ts_pkt_t starts with the same layout and may be passed too) */
+void proto_data_unpack(const data_pkt_t *pkt,
+                       int16_t *light, int16_t *motion);
+/* copy a run's n records out; dt may be NULL, it is zeroed for PKT_RUN */
+void proto_run_unpack(const run_pkt_t *pkt, uint8_t n,
+                      int16_t *light, int16_t *motion, uint8_t *dt);
+
+/* ------------ transmit side ------------ */
+uint16_t proto_build_req(req_pkt_t *pkt, uint8_t type, uint16_t src_id);
+uint16_t proto_build_ack(ack_pkt_t *pkt, uint8_t type, uint16_t src_id,
+                         uint8_t seq);
+uint16_t proto_build_slot_ack(slot_ack_pkt_t *pkt, uint16_t src_id,
+                              uint8_t slot, uint16_t wait_ms,
+                              uint16_t period_ms, uint16_t len_ms);
+uint16_t proto_build_disc(disc_pkt_t *pkt, uint16_t src_id, uint8_t seq,
+                          uint8_t flags, int8_t rssi, uint16_t wait_ms);
+uint16_t proto_build_data(data_pkt_t *pkt, uint16_t src_id, uint8_t seq,
+                          const int16_t *light, const int16_t *motion);
+/* t_off: sample times in PROTO_TICK_MS units (any origin, only the
+ * differences are sent, mod 2^16), t_prev: time of the sample before this
+ * chunk, or of the set's first sample for the first chunk */
+uint16_t proto_build_data_ts(data_ts_pkt_t *pkt, uint16_t src_id,
+                             uint8_t seq, const int16_t *light,
+                             const int16_t *motion, const uint16_t *t_off,
+                             uint16_t t_prev);
+/* n ≤ PROTO_RUN_MAX samples at off; t_off NULL builds a PKT_RUN, else a
+ * PKT_RUN_TS with t_off / t_prev as for proto_build_data_ts() */
+uint16_t proto_build_run(run_pkt_t *pkt, uint16_t src_id, uint8_t off,
+                         uint8_t n, const int16_t *light,
+                         const int16_t *motion, const uint16_t *t_off,
+                         uint16_t t_prev);
+uint16_t proto_build_block_ack(block_ack_pkt_t *pkt, uint16_t src_id,
+                               uint16_t map, uint8_t heard);
+/* start an all‑zero parity frame over n‑sample runs, then XOR each run
+ * of the group into it (the runs must all be n long and of one type) */
+uint16_t proto_build_parity(run_pkt_t *pkt, uint16_t src_id, uint8_t group,
+                            uint8_t n, uint8_t ts);
+void     proto_parity_add(run_pkt_t *pkt, const run_pkt_t *run, uint16_t len);
+uint16_t proto_build_relay(relay_pkt_t *pkt, uint16_t src_id, uint8_t batch,
+                           uint8_t idx, uint16_t origin, uint16_t collector,
+                           uint8_t set_no, uint8_t off, uint8_t n,
+                           const int16_t *light, const int16_t *motion,
+                           const uint8_t *dt);
+uint16_t proto_build_query(query_pkt_t *pkt, uint16_t src_id, uint8_t qid,
+                           uint8_t kind, uint16_t sender, uint32_t span,
+                           uint16_t skip);
+/* header for n entries the caller has put into pkt->set / pkt->hour */
+uint16_t proto_build_reply(reply_pkt_t *pkt, uint16_t src_id, uint8_t qid,
+                           uint8_t kind, uint8_t flags, uint16_t first,
+                           uint8_t n);
+uint16_t proto_build_alert(alert_pkt_t *pkt, uint16_t src_id, uint8_t seq,
+                           int16_t motion);
+uint16_t proto_build_summary(summary_pkt_t *pkt, uint16_t src_id,
+                             uint8_t seq, uint8_t n, uint16_t span,
+                             const feat_summary_t *light,
+                             const feat_summary_t *motion);
+
+#endif /* PROTOCOL_H_ */
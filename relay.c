@@ -0,0 +1,205 @@
+/*
+ * relay.c – Store‑and‑forward queue for multi‑hop set delivery
+ *           (see relay.h)
+ */
+
+#include <string.h>
+#include "contiki.h"
+#include "relay.h"
+
+#define FULL_MASK        ((1ULL << RELAY_SAMPLES) - 1)
+
+typedef struct {
+  uint16_t origin;
+  uint16_t collector;
+  uint8_t  set_no;
+} relay_key_t;
+
+static relay_set_t  queue[RELAY_QUEUE];
+static relay_set_t *batch[RELAY_BATCH_MAX];
+static uint8_t      batch_n;
+static relay_key_t  recent[RELAY_RECENT];
+static uint8_t      recent_head;
+static uint16_t     dropped;
+
+/* ------------ helpers ------------ */
+static uint8_t key_eq(const relay_set_t *s, uint16_t origin,
+                      uint16_t collector, uint8_t set_no)
+{
+  return s->origin == origin && s->collector == collector &&
+         s->set_no == set_no;
+}
+
+static uint8_t was_forwarded(uint16_t origin, uint16_t collector,
+                             uint8_t set_no)
+{
+  for(uint8_t i = 0; i < RELAY_RECENT; i++) {
+    if(recent[i].origin == origin && recent[i].collector == collector &&
+       recent[i].set_no == set_no) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/* oldest entry in state st, NULL if none (min_age: seconds) */
+static relay_set_t *oldest(uint8_t st, unsigned long min_age)
+{
+  relay_set_t *o = NULL;
+  unsigned long now = clock_seconds();
+
+  for(uint8_t i = 0; i < RELAY_QUEUE; i++) {
+    relay_set_t *s = &queue[i];
+    if(s->state != st || now - s->since < min_age) continue;
+    if(o == NULL || s->since < o->since) o = s;
+  }
+  return o;
+}
+
+/* a free entry; a partial set nobody finished is reclaimed first */
+static relay_set_t *alloc(void)
+{
+  relay_set_t *s = oldest(RELAY_FREE, 0);
+  if(s == NULL) s = oldest(RELAY_FILLING, RELAY_STALE);
+  return s;
+}
+
+static void key_set(relay_set_t *s, uint16_t origin, uint16_t collector,
+                    uint8_t set_no)
+{
+  s->origin    = origin;
+  s->collector = collector;
+  s->set_no    = set_no;
+  s->since     = clock_seconds();
+}
+
+/* ------------ API ------------ */
+void relay_init(void)
+{
+  memset(queue, 0, sizeof(queue));
+  memset(recent, 0xFF, sizeof(recent));
+  batch_n     = 0;
+  recent_head = 0;
+  dropped     = 0;
+}
+
+relay_set_t *relay_put(uint16_t origin, uint16_t collector, uint8_t set_no,
+                       const int16_t *light, const int16_t *motion,
+                       const uint8_t *dt)
+{
+  relay_set_t *s = alloc();
+  if(s == NULL) {
+    /* full: the newest data is worth more than the oldest */
+    s = oldest(RELAY_READY, 0);
+    if(s == NULL) return NULL;          /* all in flight or filling */
+    dropped++;
+  }
+  key_set(s, origin, collector, set_no);
+  memcpy(s->light,  light,  sizeof(s->light));
+  memcpy(s->motion, motion, sizeof(s->motion));
+  memcpy(s->dt,     dt,     sizeof(s->dt));
+  s->state = RELAY_READY;
+  return s;
+}
+
+uint8_t relay_rx(const relay_pkt_t *pkt, uint8_t n, relay_set_t **set)
+{
+  relay_set_t *s = NULL;
+
+  *set = NULL;
+  if(pkt->off + n > RELAY_SAMPLES) return RELAY_RX_STORED;   /* ignore */
+  if(was_forwarded(pkt->origin, pkt->collector, pkt->set_no)) {
+    return RELAY_RX_STORED;
+  }
+  for(uint8_t i = 0; i < RELAY_QUEUE && s == NULL; i++) {
+    if(queue[i].state != RELAY_FREE &&
+       key_eq(&queue[i], pkt->origin, pkt->collector, pkt->set_no)) {
+      s = &queue[i];
+    }
+  }
+  if(s == NULL) {
+    s = alloc();
+    if(s == NULL) return RELAY_RX_FULL;
+    key_set(s, pkt->origin, pkt->collector, pkt->set_no);
+    s->have  = 0;
+    s->state = RELAY_FILLING;
+  }
+  *set = s;
+  if(s->state != RELAY_FILLING) return RELAY_RX_STORED;   /* duplicate */
+
+  for(uint8_t i = 0; i < n; i++) {
+    s->light[pkt->off + i]  = pkt->rec[i].light;
+    s->motion[pkt->off + i] = pkt->rec[i].motion;
+    s->dt[pkt->off + i]     = pkt->rec[i].dt;
+  }
+  s->have |= ((1ULL << n) - 1) << pkt->off;
+  if(s->have != FULL_MASK) return RELAY_RX_STORED;
+
+  s->state = RELAY_READY;
+  s->since = clock_seconds();
+  return RELAY_RX_COMPLETE;
+}
+
+uint8_t relay_ready(unsigned long *oldest_age)
+{
+  relay_set_t *o = oldest(RELAY_READY, 0);
+  uint8_t n = 0;
+
+  for(uint8_t i = 0; i < RELAY_QUEUE; i++) {
+    if(queue[i].state == RELAY_READY) n++;
+  }
+  *oldest_age = o != NULL ? clock_seconds() - o->since : 0;
+  return n;
+}
+
+uint8_t relay_batch(uint8_t max_sets)
+{
+  relay_set_t *s;
+
+  if(max_sets > RELAY_BATCH_MAX) max_sets = RELAY_BATCH_MAX;
+  batch_n = 0;
+  while(batch_n < max_sets && (s = oldest(RELAY_READY, 0)) != NULL) {
+    s->state = RELAY_SENDING;
+    batch[batch_n++] = s;
+  }
+  return batch_n * RELAY_SET_FRAMES;
+}
+
+uint16_t relay_frame(relay_pkt_t *pkt, uint16_t src_id, uint8_t batch_no,
+                     uint8_t idx, uint8_t flags)
+{
+  const relay_set_t *s = batch[idx / RELAY_SET_FRAMES];
+  uint8_t off = (idx % RELAY_SET_FRAMES) * PROTO_RELAY_RUN;
+  uint8_t n   = RELAY_SAMPLES - off < PROTO_RELAY_RUN ?
+                RELAY_SAMPLES - off : PROTO_RELAY_RUN;
+
+  return proto_build_relay(pkt, src_id, batch_no, idx | flags, s->origin,
+                           s->collector, s->set_no, off, n, &s->light[off],
+                           &s->motion[off], &s->dt[off]);
+}
+
+void relay_release(relay_set_t *s)
+{
+  recent[recent_head].origin    = s->origin;
+  recent[recent_head].collector = s->collector;
+  recent[recent_head].set_no    = s->set_no;
+  recent_head = (recent_head + 1) % RELAY_RECENT;
+  s->state = RELAY_FREE;
+}
+
+void relay_done(void)
+{
+  for(uint8_t i = 0; i < batch_n; i++) relay_release(batch[i]);
+  batch_n = 0;
+}
+
+void relay_abort(void)
+{
+  for(uint8_t i = 0; i < batch_n; i++) batch[i]->state = RELAY_READY;
+  batch_n = 0;
+}
+
+uint16_t relay_dropped(void)
+{
+  return dropped;
+}
@@ -0,0 +1,78 @@
+/*
+ * relay.h – Store‑and‑forward queue for multi‑hop set delivery
+ *
+ * A Node B in relay mode keeps completed sets – its own, received from
+ * Node As, and those handed over by child relays – in a bounded queue
+ * until the parent hop has acknowledged them.  A set is keyed by
+ * (origin, collector, set_no), so a retransmission or the same set
+ * arriving twice is stored once; keys of recently forwarded sets are
+ * remembered for the same reason.
+ *
+ *   relay_put()     queue a set completed locally; when the queue is
+ *                   full the oldest ready set is dropped
+ *   relay_rx()      store one PKT_RELAY run from a child; 0 = no room,
+ *                   leave it unacknowledged so the child retries later
+ *                   (backpressure instead of loss)
+ *   relay_ready()   number of ready sets and the age of the oldest
+ *   relay_batch()   take up to RELAY_BATCH_MAX ready sets for one hop
+ *                   transfer, returns its frame count
+ *   relay_frame()   build frame idx of that batch
+ *   relay_done()    the parent acknowledged the batch: free it
+ *   relay_abort()   the hop transfer failed: its sets are ready again,
+ *                   for the next batch
+ *   relay_release() free one set (the sink, once it is logged)
+ *
+ * Each set travels as RELAY_SET_FRAMES PKT_RELAY frames of
+ * PROTO_RELAY_RUN samples with per‑sample time deltas.
+ */
+
+#ifndef RELAY_H_
+#define RELAY_H_
+
+#include <stdint.h>
+#include "protocol.h"
+
+#define RELAY_SAMPLES        60    /* samples per set, as SAMPLES */
+#define RELAY_SET_FRAMES     ((RELAY_SAMPLES + PROTO_RELAY_RUN - 1) / PROTO_RELAY_RUN)
+
+#ifdef RELAY_CONF_QUEUE
+#define RELAY_QUEUE          RELAY_CONF_QUEUE
+#else
+#define RELAY_QUEUE          6     /* sets held per node */
+#endif
+#define RELAY_BATCH_MAX      (16 / RELAY_SET_FRAMES)   /* block ACK map */
+#define RELAY_RECENT         8     /* forwarded keys kept for dedup */
+#define RELAY_STALE          120   /* s: a partial set may be reclaimed */
+
+enum { RELAY_FREE = 0, RELAY_FILLING, RELAY_READY, RELAY_SENDING };
+enum { RELAY_RX_FULL = 0, RELAY_RX_STORED, RELAY_RX_COMPLETE };
+
+typedef struct {
+  uint8_t       state;
+  uint8_t       set_no;
+  uint16_t      origin;
+  uint16_t      collector;
+  uint64_t      have;            /* RELAY_FILLING: samples received */
+  unsigned long since;           /* clock_seconds(): first run / ready */
+  int16_t       light[RELAY_SAMPLES];
+  int16_t       motion[RELAY_SAMPLES];
+  uint8_t       dt[RELAY_SAMPLES];  /* PROTO_TICK_MS to the previous one */
+} relay_set_t;
+
+void         relay_init(void);
+relay_set_t *relay_put(uint16_t origin, uint16_t collector, uint8_t set_no,
+                       const int16_t *light, const int16_t *motion,
+                       const uint8_t *dt);
+/* RELAY_RX_*; *set is the set the run belongs to (NULL if forwarded) */
+uint8_t      relay_rx(const relay_pkt_t *pkt, uint8_t n, relay_set_t **set);
+uint8_t      relay_ready(unsigned long *oldest_age);
+uint8_t      relay_batch(uint8_t max_sets);
+uint16_t     relay_frame(relay_pkt_t *pkt, uint16_t src_id, uint8_t batch,
+                         uint8_t idx, uint8_t flags);
+void         relay_done(void);
+void         relay_abort(void);
+void         relay_release(relay_set_t *set);
+/* sets dropped by relay_put() on a full queue, since boot */
+uint16_t     relay_dropped(void);
+
+#endif /* RELAY_H_ */
@@ -0,0 +1,50 @@
+/*
+ * retry_ctl.c – Bounded‑energy retry policy (see retry_ctl.h)
+ */
+
+#include "contiki.h"
+#include "lib/random.h"
+#include "retry_ctl.h"
+
+void retry_init(retry_ctl_t *r)
+{
+  r->fails        = 0;
+  r->spent_ms     = 0;
+  r->period_start = clock_seconds();
+}
+
+void retry_reset(retry_ctl_t *r)
+{
+  r->fails = 0;
+}
+
+uint8_t retry_take(retry_ctl_t *r, uint16_t cost_ms)
+{
+  unsigned long now = clock_seconds();
+
+  if(now - r->period_start >= RETRY_PERIOD) {
+    r->period_start = now;
+    r->spent_ms     = 0;
+  }
+  if(r->spent_ms + cost_ms > RETRY_BUDGET_MS) return 0;
+
+  r->spent_ms += cost_ms;
+  return 1;
+}
+
+rtimer_clock_t retry_backoff(retry_ctl_t *r)
+{
+  if(r->fails < UINT16_MAX) r->fails++;
+  if(r->fails <= RETRY_FAST_TRIES) return RETRY_BASE;
+
+  /* double per failure past the fast tries, stop at RETRY_MAX */
+  rtimer_clock_t gap = RETRY_BASE;
+  for(uint16_t n = r->fails - RETRY_FAST_TRIES; n && gap < RETRY_MAX; n--) {
+    gap <<= 1;
+  }
+  if(gap > RETRY_MAX) gap = RETRY_MAX;
+
+  /* jitter: up to +50 % */
+  return gap + (rtimer_clock_t)((uint64_t)(gap / 2) * random_rand()
+                                / RANDOM_RAND_MAX);
+}
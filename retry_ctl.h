@@ -0,0 +1,67 @@
+/*
+ * retry_ctl.h – Bounded‑energy retry policy for link requests
+ *
+ * Decides when a node that gets no answer should try again:
+ *
+ *   – the first RETRY_FAST_TRIES attempts are RETRY_BASE apart, enough
+ *     to ride out a busy or briefly absent peer;
+ *   – after that the gap doubles per failed attempt up to RETRY_MAX, with
+ *     up to 50 % random jitter so tags that lost the same peer spread out;
+ *   – every attempt is charged its radio‑on time against a budget of
+ *     RETRY_BUDGET_MS per RETRY_PERIOD seconds; once spent, retry_take()
+ *     refuses until the period rolls over.
+ *
+ * retry_reset() (on any reply from the peer, a heard beacon or new
+ * motion) returns to fast attempts; the budget is not refilled.
+ *
+ * Worst case for a tag that never finds its peer is RETRY_BUDGET_MS of
+ * radio‑on time per hour, independent of how long it stays out of range.
+ */
+
+#ifndef RETRY_CTL_H_
+#define RETRY_CTL_H_
+
+#include <stdint.h>
+#include "contiki.h"
+#include "sys/rtimer.h"
+
+#ifdef RETRY_CONF_BASE
+#define RETRY_BASE          RETRY_CONF_BASE
+#else
+#define RETRY_BASE          (RTIMER_SECOND / 10)
+#endif
+
+#ifdef RETRY_CONF_MAX
+#define RETRY_MAX           RETRY_CONF_MAX
+#else
+#define RETRY_MAX           (RTIMER_SECOND * 30)
+#endif
+
+#ifdef RETRY_CONF_FAST_TRIES
+#define RETRY_FAST_TRIES    RETRY_CONF_FAST_TRIES
+#else
+#define RETRY_FAST_TRIES    10
+#endif
+
+#ifdef RETRY_CONF_BUDGET_MS
+#define RETRY_BUDGET_MS     RETRY_CONF_BUDGET_MS
+#else
+#define RETRY_BUDGET_MS     36000UL     /* 1 % radio duty cycle */
+#endif
+
+#define RETRY_PERIOD        3600        /* budget period, seconds */
+
+typedef struct {
+  uint16_t      fails;        /* consecutive unanswered attempts */
+  uint32_t      spent_ms;     /* radio‑on time charged this period */
+  unsigned long period_start; /* clock_seconds() */
+} retry_ctl_t;
+
+void           retry_init(retry_ctl_t *r);
+void           retry_reset(retry_ctl_t *r);
+/* charge one attempt of cost_ms; 0 if the budget is spent */
+uint8_t        retry_take(retry_ctl_t *r, uint16_t cost_ms);
+/* count a failed attempt and return the gap to the next one */
+rtimer_clock_t retry_backoff(retry_ctl_t *r);
+
+#endif /* RETRY_CTL_H_ */
@@ -0,0 +1,42 @@
+/*
+ * sensor_src.c – SensorTag backend of the sample source (see sensor_src.h)
+ */
+
+#include <math.h>
+#include "contiki.h"
+#include "sensor_src.h"
+
+int16_t sensor_src_magnitude(int ax, int ay, int az)
+{
+  float g = sqrtf((float)ax*ax + (float)ay*ay + (float)az*az) / 16384.0f;
+  return (int16_t)(g * 100);        /* centi‑g */
+}
+
+#if !SENSOR_SRC_REPLAY
+
+#include "board-peripherals.h"
+
+void sensor_src_init(void)
+{
+  SENSORS_ACTIVATE(mpu_9250_sensor);
+  SENSORS_ACTIVATE(opt_3001_sensor);
+}
+
+void sensor_src_tick(void)
+{
+  /* live sensors: nothing to advance */
+}
+
+int16_t sensor_src_light(void)
+{
+  return opt_3001_sensor.value(0);
+}
+
+int16_t sensor_src_motion(void)
+{
+  return sensor_src_magnitude(mpu_9250_sensor.value(MPU_9250_SENSOR_TYPE_ACC_X),
+                              mpu_9250_sensor.value(MPU_9250_SENSOR_TYPE_ACC_Y),
+                              mpu_9250_sensor.value(MPU_9250_SENSOR_TYPE_ACC_Z));
+}
+
+#endif /* !SENSOR_SRC_REPLAY */
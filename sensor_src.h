@@ -0,0 +1,45 @@
+/*
+ * sensor_src.h – Light / motion sample source
+ *
+ * Firmwares read their sensors through this interface so the backend
+ * can be swapped:
+ *
+ *   board   (default)  OPT3001 + MPU9250 on the SensorTag
+ *   replay             recorded trace, native build only
+ *                      (native/sensor_replay.c, SENSOR_SRC_CONF_REPLAY)
+ *
+ * Call sensor_src_tick() once per sampling period before reading; the
+ * replay backend uses it to advance through the trace.
+ *
+ * SENSOR_SRC_SPEEDUP (SENSOR_SRC_CONF_SPEEDUP, default 1) compresses the
+ * sampling clock: firmwares divide their sample interval by it and the
+ * replay backend advances the trace by the same factor, so a recorded
+ * hour replays in 60/N minutes with the same samples.
+ */
+
+#ifndef SENSOR_SRC_H_
+#define SENSOR_SRC_H_
+
+#include <stdint.h>
+
+#ifdef SENSOR_SRC_CONF_SPEEDUP
+#define SENSOR_SRC_SPEEDUP    SENSOR_SRC_CONF_SPEEDUP
+#else
+#define SENSOR_SRC_SPEEDUP    1
+#endif
+
+#ifdef SENSOR_SRC_CONF_REPLAY
+#define SENSOR_SRC_REPLAY     SENSOR_SRC_CONF_REPLAY
+#else
+#define SENSOR_SRC_REPLAY     0
+#endif
+
+void    sensor_src_init(void);
+void    sensor_src_tick(void);
+int16_t sensor_src_light(void);      /* OPT3001 units (lux * 100)   */
+int16_t sensor_src_motion(void);     /* |acc| in centi‑g            */
+
+/* |(ax, ay, az)| in centi‑g from raw MPU9250 readings (16384 / g) */
+int16_t sensor_src_magnitude(int ax, int ay, int az);
+
+#endif /* SENSOR_SRC_H_ */
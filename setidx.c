@@ -0,0 +1,150 @@
+/*
+ * setidx.c – In‑memory index over the sets Node B has stored
+ *            (see setidx.h)
+ */
+
+#include <string.h>
+#include "contiki.h"
+#include "setidx.h"
+
+#define UNTIMED          0xFFFFFFFFUL
+
+typedef struct __attribute__((packed)) {
+  uint32_t seq;
+  uint32_t t;                /* clock_seconds() when logged, UNTIMED */
+  uint16_t origin;
+  int16_t  light;
+  int16_t  motion;
+} setidx_ent_t;
+
+static setidx_ent_t ent[SETIDX_SIZE];
+static uint16_t     next;          /* slot the next set goes to */
+static uint16_t     count;
+
+/* i‑th oldest entry */
+static const setidx_ent_t *at(uint16_t i)
+{
+  return &ent[(next + SETIDX_SIZE - count + i) % SETIDX_SIZE];
+}
+
+static uint8_t sender_ok(const setidx_ent_t *e, uint16_t sender)
+{
+  return sender == QUERY_ANY || e->origin == sender;
+}
+
+static int16_t mean(const int16_t *v, uint8_t n)
+{
+  int32_t sum = 0;
+  for(uint8_t i = 0; i < n; i++) sum += v[i];
+  return (int16_t)(sum / n);
+}
+
+/* ------------ API ------------ */
+void setidx_init(void)
+{
+  next  = 0;
+  count = 0;
+}
+
+void setidx_add(uint32_t seq, uint16_t origin, uint8_t timed,
+                unsigned long t, uint8_t n, const int16_t *light,
+                const int16_t *motion)
+{
+  setidx_ent_t *e = &ent[next];
+
+  if(n == 0) return;
+  e->seq    = seq;
+  e->t      = timed ? t : UNTIMED;
+  e->origin = origin;
+  e->light  = mean(light, n);
+  e->motion = mean(motion, n);
+  next = (next + 1) % SETIDX_SIZE;
+  if(count < SETIDX_SIZE) count++;
+}
+
+uint8_t setidx_sets(uint16_t sender, uint32_t span, uint16_t skip,
+                    query_set_rec_t *out, uint8_t max, uint8_t *more)
+{
+  unsigned long now = clock_seconds();
+  uint16_t matched = 0;
+  uint8_t  n = 0;
+
+  *more = 0;
+  for(uint16_t i = 0; i < count; i++) {
+    const setidx_ent_t *e = at(i);
+    if(!sender_ok(e, sender)) continue;
+    if(span && (e->t == UNTIMED || now - e->t > span)) continue;
+    if(matched++ < skip) continue;
+    if(n == max) {
+      *more = 1;
+      break;
+    }
+    out[n].seq    = e->seq;
+    out[n].origin = e->origin;
+    out[n].age    = e->t == UNTIMED ? QUERY_AGE_UNKNOWN : now - e->t;
+    out[n].light  = e->light;
+    out[n].motion = e->motion;
+    n++;
+  }
+  return n;
+}
+
+uint8_t setidx_hourly(uint16_t sender, uint32_t span, uint16_t skip,
+                      query_hour_rec_t *out, uint8_t max, uint8_t *more)
+{
+  unsigned long now = clock_seconds();
+  uint32_t hours = span ? (span + 3599) / 3600 : SETIDX_HOURS_MAX + 1;
+  uint32_t last = 0;
+  uint16_t matched = 0;
+  uint8_t  n = 0;
+
+  *more = 0;
+  if(hours > SETIDX_HOURS_MAX + 1) hours = SETIDX_HOURS_MAX + 1;
+
+  /* hours that hold any timed set, to bound the walk */
+  for(uint16_t i = 0; i < count; i++) {
+    const setidx_ent_t *e = at(i);
+    if(e->t != UNTIMED && (now - e->t) / 3600 > last) last = (now - e->t) / 3600;
+  }
+  if(last + 1 < hours) hours = last + 1;
+
+  for(uint32_t h = 0; h < hours; h++) {
+    for(uint16_t i = 0; i < count; i++) {
+      const setidx_ent_t *e = at(i);
+      int32_t light = 0, motion = 0;
+      uint8_t sets = 0, seen = 0;
+
+      if(e->t == UNTIMED || (now - e->t) / 3600 != h || !sender_ok(e, sender)) {
+        continue;
+      }
+      /* each sender once per hour, at its oldest set of the hour */
+      for(uint16_t j = 0; j < i && !seen; j++) {
+        const setidx_ent_t *f = at(j);
+        seen = f->origin == e->origin && f->t != UNTIMED &&
+               (now - f->t) / 3600 == h;
+      }
+      if(seen || matched++ < skip) continue;
+      if(n == max) {
+        *more = 1;
+        return n;
+      }
+      for(uint16_t j = i; j < count; j++) {
+        const setidx_ent_t *f = at(j);
+        if(f->origin != e->origin || f->t == UNTIMED ||
+           (now - f->t) / 3600 != h || sets == UINT8_MAX) {
+          continue;
+        }
+        light  += f->light;
+        motion += f->motion;
+        sets++;
+      }
+      out[n].origin = e->origin;
+      out[n].hour   = (uint8_t)h;
+      out[n].count  = sets;
+      out[n].light  = (int16_t)(light / sets);
+      out[n].motion = (int16_t)(motion / sets);
+      n++;
+    }
+  }
+  return n;
+}
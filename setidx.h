@@ -0,0 +1,45 @@
+/*
+ * setidx.h – In‑memory index over the sets Node B has stored
+ *
+ * One small entry per set – log sequence number, Node A, time logged
+ * and the set's light / motion means – for the newest SETIDX_SIZE sets.
+ * Pull queries (protocol.h, MGMT_QUERY) are answered from here without
+ * touching the flash log; a consumer that wants the samples themselves
+ * asks for the log records by seq ("DUMP seq", setlog.h).
+ *
+ *   setidx_add()      index a set as it is logged, or while rebuilding
+ *                     from the log after a reset
+ *   setidx_sets()     catalog entries, oldest first
+ *   setidx_hourly()   per sender and hour means, last hour first
+ *
+ * Both answer one page: entries skip … skip+max−1 of the full answer,
+ * *more set if there are entries after them.  clock_seconds() restarts
+ * with Node B, so sets rebuilt from before a reset have no time: they
+ * are listed with QUERY_AGE_UNKNOWN but left out of span and hourly
+ * queries.
+ */
+
+#ifndef SETIDX_H_
+#define SETIDX_H_
+
+#include <stdint.h>
+#include "protocol.h"
+
+#ifdef SETIDX_CONF_SIZE
+#define SETIDX_SIZE          SETIDX_CONF_SIZE
+#else
+#define SETIDX_SIZE          128   /* 14 bytes each */
+#endif
+#define SETIDX_HOURS_MAX     255
+
+void    setidx_init(void);
+/* timed: t (clock_seconds()) is from this boot */
+void    setidx_add(uint32_t seq, uint16_t origin, uint8_t timed,
+                   unsigned long t, uint8_t n, const int16_t *light,
+                   const int16_t *motion);
+uint8_t setidx_sets(uint16_t sender, uint32_t span, uint16_t skip,
+                    query_set_rec_t *out, uint8_t max, uint8_t *more);
+uint8_t setidx_hourly(uint16_t sender, uint32_t span, uint16_t skip,
+                      query_hour_rec_t *out, uint8_t max, uint8_t *more);
+
+#endif /* SETIDX_H_ */
@@ -0,0 +1,344 @@
+/*
+ * setlog.c – Persistent log of received sets on the external flash
+ *            (see setlog.h)
+ */
+
+#include <stddef.h>
+#include <string.h>
+#include "contiki.h"
+#include "lib/crc16.h"
+#include "ext-flash.h"
+#include "setlog.h"
+
+#define AREA             ((uint32_t)SETLOG_SECTORS * SETLOG_SECTOR)
+#define SECTOR_OF(pos)   ((uint16_t)((pos) / SETLOG_SECTOR))
+#define SECTOR_AT(s)     ((uint32_t)(s) * SETLOG_SECTOR)
+#define NEXT_PAGE(pos)   (((pos) | (SETLOG_PAGE - 1)) + 1)
+#define REC_LEN(n)       (sizeof(setlog_hdr_t) + (n) * sizeof(run_rec_ts_t))
+#define CRC_SPAN         offsetof(setlog_hdr_t, crc)
+#define READ_RECS        10        /* records per flash read */
+
+static uint8_t  page[SETLOG_PAGE];     /* write buffer */
+static uint32_t page_addr;             /* its place in the log area */
+static uint16_t page_fill;
+static uint16_t head;                  /* sector being written */
+static uint32_t head_seq;
+static uint32_t next_seq;
+static uint8_t  boot;
+static uint8_t  mounted;
+
+/* ------------ flash access ------------ */
+/* the buffered page and the unwritten rest of the head sector are read
+ * from RAM / as erased */
+static uint8_t area_read(uint32_t pos, uint16_t len, void *buf)
+{
+  uint8_t *out = buf;
+
+  if(SECTOR_OF(pos) == head && pos + len > page_addr) {
+    uint16_t flash_len = pos < page_addr ? page_addr - pos : 0;
+    if(flash_len &&
+       !ext_flash_read(NULL, SETLOG_BASE + pos, flash_len, out)) {
+      return 0;
+    }
+    for(uint16_t i = flash_len; i < len; i++) {
+      uint32_t at = pos + i - page_addr;
+      out[i] = at < page_fill ? page[at] : 0xFF;
+    }
+    return 1;
+  }
+  return ext_flash_read(NULL, SETLOG_BASE + pos, len, out);
+}
+
+static uint8_t program_page(void)
+{
+  uint8_t ok = ext_flash_write(NULL, SETLOG_BASE + page_addr, SETLOG_PAGE,
+                               page);
+  page_addr += SETLOG_PAGE;
+  page_fill  = 0;
+  memset(page, 0xFF, sizeof(page));
+  return ok;
+}
+
+static uint8_t put(const void *data, uint16_t len)
+{
+  const uint8_t *in = data;
+
+  while(len) {
+    uint16_t k = SETLOG_PAGE - page_fill;
+    if(k > len) k = len;
+    memcpy(&page[page_fill], in, k);
+    page_fill += k;
+    in  += k;
+    len -= k;
+    if(page_fill == SETLOG_PAGE && !program_page()) return 0;
+  }
+  return 1;
+}
+
+/* erase the sector after the head (the oldest) and start writing it */
+static uint8_t start_sector(void)
+{
+  setlog_sector_t sh;
+
+  head = (head + 1) % SETLOG_SECTORS;
+  head_seq++;
+  page_addr = SECTOR_AT(head);
+  page_fill = 0;
+  memset(page, 0xFF, sizeof(page));
+  if(!ext_flash_erase(NULL, SETLOG_BASE + page_addr, SETLOG_SECTOR)) return 0;
+
+  sh.magic      = SETLOG_SECTOR_MAGIC;
+  sh.sector_seq = head_seq;
+  sh.first_seq  = next_seq;
+  return put(&sh, sizeof(sh));
+}
+
+/* ------------ records ------------ */
+static uint8_t hdr_ok(const setlog_hdr_t *h, uint32_t pos)
+{
+  return h->magic == SETLOG_REC_MAGIC && h->n > 0 && h->n <= SETLOG_MAX_N &&
+         pos + REC_LEN(h->n) <= SECTOR_AT(SECTOR_OF(pos) + 1);
+}
+
+/* read the records behind h (arrays may be NULL) and check the CRC */
+static uint8_t rec_read(uint32_t pos, const setlog_hdr_t *h, int16_t *light,
+                        int16_t *motion, uint8_t *dt)
+{
+  run_rec_ts_t   rec[READ_RECS];
+  unsigned short crc = crc16_data((const unsigned char *)h, CRC_SPAN, 0);
+
+  pos += sizeof(*h);
+  for(uint8_t i = 0; i < h->n; i += READ_RECS) {
+    uint8_t k = h->n - i < READ_RECS ? h->n - i : READ_RECS;
+    if(!area_read(pos, k * sizeof(rec[0]), rec)) return 0;
+    crc = crc16_data((const unsigned char *)rec, k * sizeof(rec[0]), crc);
+    pos += k * sizeof(rec[0]);
+    if(light == NULL) continue;
+    for(uint8_t j = 0; j < k; j++) {
+      light[i + j]  = rec[j].light;
+      motion[i + j] = rec[j].motion;
+      dt[i + j]     = rec[j].dt;
+    }
+  }
+  return crc == h->crc;
+}
+
+/* walk sector s, return the end of its last good record (0: none) and
+ * take seq / boot from it */
+static uint32_t scan_sector(uint16_t s)
+{
+  uint32_t pos = SECTOR_AT(s) + sizeof(setlog_sector_t);
+  uint32_t end = 0;
+  setlog_hdr_t h;
+
+  while(pos + sizeof(h) <= SECTOR_AT(s + 1)) {
+    if(area_read(pos, sizeof(h), &h) && hdr_ok(&h, pos) &&
+       rec_read(pos, &h, NULL, NULL, NULL)) {
+      next_seq = h.seq + 1;
+      boot     = h.boot + 1;
+      pos += REC_LEN(h.n);
+      end  = pos;
+    } else {
+      pos = NEXT_PAGE(pos);
+    }
+  }
+  return end;
+}
+
+static uint8_t page_erased(uint32_t pos)
+{
+  uint8_t buf[32];
+
+  for(uint16_t i = 0; i < SETLOG_PAGE; i += sizeof(buf)) {
+    if(!area_read(pos + i, sizeof(buf), buf)) return 0;
+    for(uint8_t j = 0; j < sizeof(buf); j++) {
+      if(buf[j] != 0xFF) return 0;
+    }
+  }
+  return 1;
+}
+
+/* ------------ API ------------ */
+int setlog_init(void)
+{
+  setlog_sector_t sh;
+  uint8_t found = 0;
+
+  mounted = 0;
+  if(!ext_flash_open(NULL)) return -1;
+
+  head      = SETLOG_SECTORS;          /* no RAM page while mounting */
+  page_addr = AREA;
+  page_fill = 0;
+  memset(page, 0xFF, sizeof(page));
+  next_seq  = 0;
+  boot      = 0;
+
+  for(uint16_t s = 0; s < SETLOG_SECTORS; s++) {
+    if(!area_read(SECTOR_AT(s), sizeof(sh), &sh) ||
+       sh.magic != SETLOG_SECTOR_MAGIC) {
+      continue;
+    }
+    if(!found || (int32_t)(sh.sector_seq - head_seq) > 0) {
+      head      = s;
+      head_seq  = sh.sector_seq;
+      next_seq  = sh.first_seq;
+      found     = 1;
+    }
+  }
+
+  if(!found) {
+    head     = SETLOG_SECTORS - 1;     /* start_sector() → sector 0 */
+    head_seq = 0;
+    mounted  = start_sector();
+  } else {
+    uint16_t h = head;
+    uint32_t resume;
+
+    head = SETLOG_SECTORS;
+    if(scan_sector(h) == 0) {
+      /* nothing in the head yet: the boot count is in the one before */
+      uint32_t seq = next_seq;
+      scan_sector((h + SETLOG_SECTORS - 1) % SETLOG_SECTORS);
+      next_seq = seq;
+    }
+    /* continue after the last programmed page, torn record or not */
+    resume = SECTOR_AT(h + 1);
+    while(resume > SECTOR_AT(h) && page_erased(resume - SETLOG_PAGE)) {
+      resume -= SETLOG_PAGE;
+    }
+    head      = h;
+    page_addr = resume;
+    mounted   = 1;
+  }
+
+  ext_flash_close(NULL);
+  return mounted ? 0 : -1;
+}
+
+uint32_t setlog_append(uint16_t origin, uint16_t collector, uint8_t set_no,
+                       uint8_t n, const int16_t *light,
+                       const int16_t *motion, const uint8_t *dt)
+{
+  setlog_hdr_t h;
+  run_rec_ts_t rec;
+  uint8_t ok = 1;
+
+  if(!mounted || n == 0 || n > SETLOG_MAX_N || !ext_flash_open(NULL)) {
+    return SETLOG_NONE;
+  }
+
+  if(page_addr + page_fill + REC_LEN(n) > SECTOR_AT(head + 1)) {
+    /* seal the sector: pad out its last page, move on */
+    if(page_fill) ok = program_page();
+    ok = ok && start_sector();
+  }
+
+  h.magic     = SETLOG_REC_MAGIC;
+  h.n         = n;
+  h.origin    = origin;
+  h.collector = collector;
+  h.set_no    = set_no;
+  h.boot      = boot;
+  h.seq       = next_seq;
+  h.t         = clock_seconds();
+  h.crc       = crc16_data((const unsigned char *)&h, CRC_SPAN, 0);
+  for(uint8_t i = 0; i < n; i++) {
+    rec.light  = light[i];
+    rec.motion = motion[i];
+    rec.dt     = dt[i];
+    h.crc = crc16_data((const unsigned char *)&rec, sizeof(rec), h.crc);
+  }
+
+  ok = ok && put(&h, sizeof(h));
+  for(uint8_t i = 0; ok && i < n; i++) {
+    rec.light  = light[i];
+    rec.motion = motion[i];
+    rec.dt     = dt[i];
+    ok = put(&rec, sizeof(rec));
+  }
+  ext_flash_close(NULL);
+
+  if(!ok) return SETLOG_NONE;
+  return next_seq++;
+}
+
+uint8_t setlog_boot(void)
+{
+  return boot;
+}
+
+uint32_t setlog_next_seq(void)
+{
+  return next_seq;
+}
+
+void setlog_first(setlog_iter_t *it, uint32_t from_seq)
+{
+  it->sector  = (head + 1) % SETLOG_SECTORS;
+  it->off     = 0;
+  it->sectors = SETLOG_SECTORS;
+  it->from    = from_seq;
+}
+
+static void next_sector(setlog_iter_t *it)
+{
+  it->sector = (it->sector + 1) % SETLOG_SECTORS;
+  it->off    = 0;
+  it->sectors--;
+}
+
+uint8_t setlog_next(setlog_iter_t *it, setlog_hdr_t *hdr, int16_t *light,
+                    int16_t *motion, uint8_t *dt)
+{
+  uint8_t found = 0;
+
+  if(!mounted || !ext_flash_open(NULL)) return 0;
+
+  while(it->sectors && !found) {
+    uint32_t base  = SECTOR_AT(it->sector);
+    uint32_t limit = it->sector == head ? page_addr + page_fill :
+                                          base + SETLOG_SECTOR;
+    uint32_t pos;
+
+    if(it->off == 0) {
+      setlog_sector_t sh, nx;
+      uint16_t t = (it->sector + 1) % SETLOG_SECTORS;
+      uint8_t  skip = !area_read(base, sizeof(sh), &sh) ||
+                      sh.magic != SETLOG_SECTOR_MAGIC;
+      /* everything here is older than from: the next sector says so */
+      if(!skip && it->sector != head &&
+         area_read(SECTOR_AT(t), sizeof(nx), &nx) &&
+         nx.magic == SETLOG_SECTOR_MAGIC &&
+         nx.sector_seq == sh.sector_seq + 1 &&
+         (int32_t)(nx.first_seq - it->from) <= 0) {
+        skip = 1;
+      }
+      if(skip) {
+        next_sector(it);
+        continue;
+      }
+      it->off = sizeof(sh);
+    }
+
+    pos = base + it->off;
+    if(pos + sizeof(*hdr) > limit) {
+      next_sector(it);
+      continue;
+    }
+    if(!area_read(pos, sizeof(*hdr), hdr) || !hdr_ok(hdr, pos) ||
+       ((int32_t)(hdr->seq - it->from) >= 0 &&
+        !rec_read(pos, hdr, light, motion, dt))) {
+      /* padding, torn or foreign: records resume on a page boundary */
+      pos = NEXT_PAGE(pos);
+    } else {
+      found = (int32_t)(hdr->seq - it->from) >= 0;
+      pos  += REC_LEN(hdr->n);
+    }
+    if(pos >= base + SETLOG_SECTOR) next_sector(it);
+    else it->off = pos - base;
+  }
+
+  ext_flash_close(NULL);
+  return found;
+}
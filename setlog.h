@@ -0,0 +1,98 @@
+/*
+ * setlog.h – Persistent log of received sets on the external flash
+ *
+ * Node B appends every completed set to a ring of SETLOG_SECTORS erase
+ * sectors on the SensorTag's SPI flash, so it can run unattended and be
+ * offloaded later in one bulk dump.
+ *
+ * Writes go through a one‑page RAM buffer and reach the flash only as
+ * whole SETLOG_PAGE program operations: each page is programmed once
+ * per erase, and the flash is woken only per filled page (or sector
+ * erase) instead of per record.  A record that does not fit into the
+ * rest of a sector seals it (padding page) and the next sector is
+ * erased, dropping the oldest sets once the ring is full.
+ *
+ *   sector  = setlog_sector_t, then records
+ *   record  = setlog_hdr_t, then n run_rec_ts_t (protocol.h)
+ *
+ * Records carry a sequence number that keeps counting across reboots,
+ * so a consumer can resume a dump where the last one ended.  After a
+ * reset, setlog_init() finds the newest sector, checks its records'
+ * CRCs and continues at the next erased page; at most the unwritten
+ * buffer page is lost.  Readers skip a bad or padding header to the
+ * next page boundary, where every post‑reset record starts.
+ *
+ *   setlog_init()      mount the log (once, from the process)
+ *   setlog_append()    add a set, SETLOG_NONE on a flash error
+ *   setlog_first()     position an iterator at seq or the oldest after
+ *   setlog_next()      read the next record into the caller's arrays
+ *
+ * Flash access is the board's ext‑flash driver (ext_flash_*(), powered
+ * down between calls); the native build backs it with a file
+ * (native/sim_flash.c).  Not reentrant; call from one process only.
+ */
+
+#ifndef SETLOG_H_
+#define SETLOG_H_
+
+#include <stdint.h>
+#include "protocol.h"
+
+#define SETLOG_SECTOR        4096      /* flash erase unit */
+#define SETLOG_PAGE          256       /* flash program unit */
+#ifdef SETLOG_CONF_BASE
+#define SETLOG_BASE          SETLOG_CONF_BASE
+#else
+#define SETLOG_BASE          0x40000UL /* above the OTA image area */
+#endif
+#ifdef SETLOG_CONF_SECTORS
+#define SETLOG_SECTORS       SETLOG_CONF_SECTORS
+#else
+#define SETLOG_SECTORS       64        /* 256 kB, ~750 sets of 60 */
+#endif
+#define SETLOG_MAX_N         60        /* samples per record */
+#define SETLOG_NONE          UINT32_MAX
+
+#define SETLOG_SECTOR_MAGIC  0x31474C53UL   /* "SLG1" */
+#define SETLOG_REC_MAGIC     0xA5
+
+typedef struct __attribute__((packed)) {
+  uint32_t magic;
+  uint32_t sector_seq;     /* erase count of the ring, newest = head */
+  uint32_t first_seq;      /* seq of the first record written here */
+} setlog_sector_t;
+
+typedef struct __attribute__((packed)) {
+  uint8_t  magic;
+  uint8_t  n;
+  uint16_t origin;         /* Node A that collected the set */
+  uint16_t collector;      /* Node B that received it */
+  uint8_t  set_no;
+  uint8_t  boot;           /* boot count of the writer, mod 256 */
+  uint32_t seq;
+  uint32_t t;              /* clock_seconds() when logged */
+  uint16_t crc;            /* crc16 of the header up to here + records */
+} setlog_hdr_t;
+
+typedef struct {
+  uint16_t sector;
+  uint16_t off;            /* in the sector, 0: header not read yet */
+  uint16_t sectors;        /* sectors still to visit */
+  uint32_t from;           /* skip records before this seq */
+} setlog_iter_t;
+
+/* 0 if the flash answered; the log is then usable */
+int      setlog_init(void);
+uint32_t setlog_append(uint16_t origin, uint16_t collector, uint8_t set_no,
+                       uint8_t n, const int16_t *light,
+                       const int16_t *motion, const uint8_t *dt);
+/* boot count this session writes with, and the next record's seq */
+uint8_t  setlog_boot(void);
+uint32_t setlog_next_seq(void);
+
+void     setlog_first(setlog_iter_t *it, uint32_t from_seq);
+/* 1 and the record, or 0 at the end of the log; arrays: SETLOG_MAX_N */
+uint8_t  setlog_next(setlog_iter_t *it, setlog_hdr_t *hdr, int16_t *light,
+                     int16_t *motion, uint8_t *dt);
+
+#endif /* SETLOG_H_ */
@@ -0,0 +1,142 @@
+/*
+ * setq.c – Policy‑driven queue of completed sample sets (see setq.h)
+ */
+
+#include <string.h>
+#include "contiki.h"
+#include "setq.h"
+
+enum { BY_OLDEST = 0, BY_NEWEST, BY_HIGHEST, BY_LOWEST };
+
+/* a queued before b */
+static uint8_t earlier(const setq_t *q, uint8_t a, uint8_t b)
+{
+  return (int16_t)(q->no[a] - q->no[b]) < 0;
+}
+
+/* queued, unpinned slot that comes first by how; SETQ_NONE if none */
+static uint8_t find(const setq_t *q, uint8_t how)
+{
+  uint8_t best = SETQ_NONE;
+
+  for(uint8_t s = 0; s <= q->cap; s++) {
+    if(q->state[s] != SETQ_QUEUED || s == q->pinned) continue;
+    if(best == SETQ_NONE) {
+      best = s;
+      continue;
+    }
+    switch(how) {
+    case BY_OLDEST:
+      if(earlier(q, s, best)) best = s;
+      break;
+    case BY_NEWEST:
+      if(earlier(q, best, s)) best = s;
+      break;
+    case BY_HIGHEST:
+      if(q->score[s] > q->score[best] ||
+         (q->score[s] == q->score[best] && earlier(q, s, best))) {
+        best = s;
+      }
+      break;
+    default:
+      if(q->score[s] < q->score[best] ||
+         (q->score[s] == q->score[best] && earlier(q, s, best))) {
+        best = s;
+      }
+      break;
+    }
+  }
+  return best;
+}
+
+/* ------------ API ------------ */
+void setq_init(setq_t *q, uint8_t cap, uint8_t drop, uint8_t order,
+               uint16_t outage_s)
+{
+  memset(q, 0, sizeof(*q));
+  q->cap      = cap == 0 ? 1 : cap > SETQ_MAX ? SETQ_MAX : cap;
+  q->drop     = drop;
+  q->order    = order;
+  q->outage_s = outage_s;
+  q->spare    = 0;
+  q->pinned   = SETQ_NONE;
+  q->state[0] = SETQ_SPARE;
+}
+
+uint8_t setq_spare(const setq_t *q)
+{
+  return q->spare;
+}
+
+uint8_t setq_put(setq_t *q, uint16_t score)
+{
+  uint8_t s = q->spare;
+  uint8_t victim = SETQ_NONE;
+
+  q->state[s] = SETQ_QUEUED;
+  q->no[s]    = q->next_no++;
+  q->score[s] = score;
+  q->since[s] = clock_seconds();
+  q->len++;
+
+  if(q->len > q->cap) {
+    if(q->drop == SETQ_DROP_OLDEST) victim = find(q, BY_OLDEST);
+    else if(q->drop == SETQ_DROP_LOWEST) victim = find(q, BY_LOWEST);
+    if(victim == SETQ_NONE) victim = s;
+    q->state[victim] = SETQ_FREE;
+    q->len--;
+    q->dropped++;
+  }
+
+  /* cap + 1 slots, at most cap queued: one is free */
+  for(s = 0; q->state[s] != SETQ_FREE; s++);
+  q->state[s] = SETQ_SPARE;
+  q->spare    = s;
+  return victim;
+}
+
+uint8_t setq_pick(setq_t *q)
+{
+  uint8_t how;
+
+  if(q->pinned != SETQ_NONE || q->len == 0) return q->pinned;
+
+  if(q->order == SETQ_ORDER_NEWEST) {
+    how = BY_NEWEST;
+  } else if(q->order == SETQ_ORDER_SCORE) {
+    how = BY_HIGHEST;
+  } else {
+    uint8_t old = find(q, BY_OLDEST);
+    how = q->outage_s && clock_seconds() - q->since[old] >= q->outage_s ?
+          BY_NEWEST : BY_OLDEST;
+  }
+  q->pinned = find(q, how);
+  return q->pinned;
+}
+
+unsigned long setq_age(const setq_t *q)
+{
+  unsigned long now = clock_seconds(), age = 0;
+
+  for(uint8_t s = 0; s <= q->cap; s++) {
+    if(q->state[s] == SETQ_QUEUED && now - q->since[s] > age) {
+      age = now - q->since[s];
+    }
+  }
+  return age;
+}
+
+void setq_pin(setq_t *q, uint8_t slot)
+{
+  q->pinned = slot;
+}
+
+void setq_done(setq_t *q)
+{
+  if(q->pinned == SETQ_NONE) return;
+  if(q->state[q->pinned] == SETQ_QUEUED) {
+    q->state[q->pinned] = SETQ_FREE;
+    q->len--;
+  }
+  q->pinned = SETQ_NONE;
+}
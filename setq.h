@@ -0,0 +1,80 @@
+/*
+ * setq.h – Policy‑driven queue of completed sample sets
+ *
+ * Node A keeps its sets in cap + 1 storage slots: up to cap queued
+ * sets and always one spare slot the next set is collected into, so an
+ * event is recorded even while the queue is full.  Queuing that set
+ * decides which one gives way:
+ *
+ *   SETQ_DROP_NEWEST   the new set – what is queued stays
+ *   SETQ_DROP_OLDEST   the set queued longest
+ *   SETQ_DROP_LOWEST   the set with the lowest activity score, the
+ *                      new one included
+ *
+ * and uploads take the queued sets in one of these orders:
+ *
+ *   SETQ_ORDER_OLDEST  first in, first out
+ *   SETQ_ORDER_NEWEST  last in, first out
+ *   SETQ_ORDER_SCORE   highest activity first, oldest among equals
+ *
+ * With outage_s set, SETQ_ORDER_OLDEST turns newest first while the
+ * oldest set has waited that long: after a long time out of range the
+ * current state gets through before the backlog.
+ *
+ * The set being uploaded is pinned – never dropped or reordered – until
+ * setq_done().  The queue only hands out slot numbers; the caller owns
+ * the sets.
+ *
+ *   setq_spare()   slot to collect the next set into
+ *   setq_put()     queue the spare's set, returns the slot dropped
+ *   setq_pick()    pin the next set to upload (or the one pinned)
+ *   setq_pin()     pin a slot, e.g. the spare while streaming it
+ *   setq_done()    the pinned set is delivered: free its slot
+ *   setq_age()     how long the oldest queued set has waited
+ */
+
+#ifndef SETQ_H_
+#define SETQ_H_
+
+#include <stdint.h>
+
+#ifdef SETQ_CONF_MAX
+#define SETQ_MAX             SETQ_CONF_MAX
+#else
+#define SETQ_MAX             8     /* queued sets at most */
+#endif
+#define SETQ_NONE            0xFF
+
+enum { SETQ_DROP_NEWEST = 0, SETQ_DROP_OLDEST, SETQ_DROP_LOWEST };
+enum { SETQ_ORDER_OLDEST = 0, SETQ_ORDER_NEWEST, SETQ_ORDER_SCORE };
+enum { SETQ_FREE = 0, SETQ_SPARE, SETQ_QUEUED };
+
+typedef struct {
+  uint8_t       cap;
+  uint8_t       drop;                 /* SETQ_DROP_* */
+  uint8_t       order;                /* SETQ_ORDER_* */
+  uint16_t      outage_s;             /* 0: no newest‑first switch */
+  uint8_t       len;                  /* queued sets */
+  uint8_t       spare;
+  uint8_t       pinned;               /* being uploaded, SETQ_NONE */
+  uint16_t      dropped;
+  uint16_t      next_no;
+  uint8_t       state[SETQ_MAX + 1];  /* SETQ_FREE / _SPARE / _QUEUED */
+  uint16_t      no[SETQ_MAX + 1];     /* queuing order */
+  uint16_t      score[SETQ_MAX + 1];
+  unsigned long since[SETQ_MAX + 1];  /* clock_seconds() when queued */
+} setq_t;
+
+void    setq_init(setq_t *q, uint8_t cap, uint8_t drop, uint8_t order,
+                  uint16_t outage_s);
+uint8_t setq_spare(const setq_t *q);
+/* SETQ_NONE, or the slot given up – possibly the new set's own */
+uint8_t setq_put(setq_t *q, uint16_t score);
+/* SETQ_NONE if nothing is queued or pinned */
+uint8_t setq_pick(setq_t *q);
+/* s the oldest queued set has waited, 0 if none is */
+unsigned long setq_age(const setq_t *q);
+void    setq_pin(setq_t *q, uint8_t slot);
+void    setq_done(setq_t *q);
+
+#endif /* SETQ_H_ */
@@ -0,0 +1,37 @@
+/*
+ * slot_sched.c – Drift‑free slot scheduler (see slot_sched.h)
+ */
+
+#include "slot_sched.h"
+
+static void arm(slot_sched_t *s, rtimer_callback_t cb, void *ptr)
+{
+  rtimer_set(&s->rt, s->deadline, 1, cb, ptr);
+}
+
+void slot_sched_start(slot_sched_t *s, rtimer_clock_t delay,
+                      rtimer_callback_t cb, void *ptr)
+{
+  s->deadline = RTIMER_NOW() + delay;
+  arm(s, cb, ptr);
+}
+
+void slot_sched_next(slot_sched_t *s, rtimer_clock_t interval,
+                     rtimer_callback_t cb, void *ptr)
+{
+  rtimer_clock_t now = RTIMER_NOW();
+
+  s->deadline += interval;
+  if(RTIMER_CLOCK_LT(s->deadline, now + SLOT_SCHED_GUARD)) {
+    /* overran: keep the grid phase, skip to the next reachable slot */
+    s->missed++;
+    if(interval == 0) {
+      s->deadline = now + SLOT_SCHED_GUARD;
+    } else {
+      while(RTIMER_CLOCK_LT(s->deadline, now + SLOT_SCHED_GUARD)) {
+        s->deadline += interval;
+      }
+    }
+  }
+  arm(s, cb, ptr);
+}
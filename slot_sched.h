@@ -0,0 +1,44 @@
+/*
+ * slot_sched.h – Drift‑free slot scheduler for rtimer chains
+ *
+ * Re‑arming with RTIMER_NOW() + interval adds the callback latency to
+ * every slot, so the slot grid slowly walks away from the peer's.  A
+ * slot_sched_t instead keeps an absolute deadline:
+ *
+ *   slot_sched_start(s, delay, cb, ptr)   anchor the grid at NOW + delay
+ *   slot_sched_next (s, interval, cb, ptr) next slot = deadline + interval
+ *
+ * If the next deadline is already (nearly) past when it is armed, the
+ * slot is counted in s->missed and the grid is advanced by whole
+ * intervals, so the phase is kept even after an overrun.
+ *
+ * Use slot_sched_start() only where a new phase really begins (boot,
+ * reply from the peer); every periodic step should use slot_sched_next().
+ */
+
+#ifndef SLOT_SCHED_H_
+#define SLOT_SCHED_H_
+
+#include <stdint.h>
+#include "contiki.h"
+#include "sys/rtimer.h"
+
+/* minimum lead time for a deadline to be considered reachable */
+#ifdef SLOT_SCHED_CONF_GUARD
+#define SLOT_SCHED_GUARD     SLOT_SCHED_CONF_GUARD
+#else
+#define SLOT_SCHED_GUARD     (RTIMER_SECOND >= 2000 ? RTIMER_SECOND / 2000 : 1)  /* 0.5 ms */
+#endif
+
+typedef struct {
+  struct rtimer  rt;
+  rtimer_clock_t deadline;     /* absolute time of the armed slot */
+  uint16_t       missed;       /* deadlines that were already past */
+} slot_sched_t;
+
+void slot_sched_start(slot_sched_t *s, rtimer_clock_t delay,
+                      rtimer_callback_t cb, void *ptr);
+void slot_sched_next(slot_sched_t *s, rtimer_clock_t interval,
+                     rtimer_callback_t cb, void *ptr);
+
+#endif /* SLOT_SCHED_H_ */
@@ -0,0 +1,292 @@
+/*
+ * proto_test.c – Host round‑trip tests for the frame codec (protocol.h)
+ *
+ * usage: proto_test
+ *
+ * Every frame type is built with its proto_build_*() and read back
+ * through its proto_*_view(); the fields must come out as they went in.
+ * The same frame one byte short, with another packet type or with
+ * another version in the header must be rejected.  Prints each failed
+ * check and exits non‑zero if there was one.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "protocol.h"
+
+static unsigned checks, failed;
+
+#define CHECK(c) do {                                                   \
+    checks++;                                                           \
+    if(!(c)) {                                                          \
+      failed++;                                                         \
+      printf("%s:%d: %s\n", __FILE__, __LINE__, #c);                    \
+    }                                                                   \
+  } while(0)
+
+/* frame f of len bytes: seen by view as is, not one byte short, not as
+ * packet type other, not with a foreign version nibble */
+#define REJECTS(view, f, len, other) do {                               \
+    uint8_t m_[sizeof(f)];                                              \
+    memcpy(m_, &(f), sizeof(m_));                                       \
+    CHECK(view(m_, (len)) != NULL);                                     \
+    CHECK(view(m_, (len) - 1) == NULL);                                 \
+    m_[0] = (uint8_t)((m_[0] & 0xF0) | (other));                        \
+    CHECK(view(m_, (len)) == NULL);                                     \
+    memcpy(m_, &(f), sizeof(m_));                                       \
+    m_[0] = (uint8_t)(0xF0 | (m_[0] & 0x0F));                           \
+    CHECK(view(m_, (len)) == NULL);                                     \
+  } while(0)
+
+
+/* views with a record count, in the shape REJECTS() takes */
+static uint8_t n;
+
+static const run_pkt_t *run_view(const void *d, uint16_t len)
+{
+  return proto_run_view(d, len, &n);
+}
+
+
+static const relay_pkt_t *relay_view(const void *d, uint16_t len)
+{
+  return proto_relay_view(d, len, &n);
+}
+
+
+static const reply_pkt_t *reply_view(const void *d, uint16_t len)
+{
+  return proto_reply_view(d, len, &n);
+}
+
+
+static int16_t light[PROTO_CHUNK_SIZE], motion[PROTO_CHUNK_SIZE];
+static uint16_t t_off[PROTO_CHUNK_SIZE];
+
+static void test_req_ack(void)
+{
+  req_pkt_t req;
+  ack_pkt_t ack;
+  uint16_t len;
+
+  len = proto_build_req(&req, PKT_REQUEST, 0x1234);
+  CHECK(proto_type(&req, len) == PKT_REQUEST);
+  CHECK(proto_req_view(&req, len)->src_id == 0x1234);
+  REJECTS(proto_req_view, req, len, PKT_DATA);
+  len = proto_build_req(&req, PKT_BEACON, 7);
+  CHECK(proto_type(&req, len) == PKT_BEACON);
+  REJECTS(proto_req_view, req, len, PKT_ACK);
+
+  len = proto_build_ack(&ack, PKT_ACK, 2, 42);
+  CHECK(proto_ack_view(&ack, len)->seq == 42);
+  REJECTS(proto_ack_view, ack, len, PKT_REQUEST);
+  len = proto_build_ack(&ack, PKT_REQ_ACK, 2, 0);
+  REJECTS(proto_ack_view, ack, len, PKT_BEACON);
+  len = proto_build_ack(&ack, PKT_ALERT_ACK, 2, 9);
+  CHECK(proto_type(&ack, len) == PKT_ALERT_ACK);
+  REJECTS(proto_ack_view, ack, len, PKT_ALERT);
+}
+
+static void test_slot_ack(void)
+{
+  slot_ack_pkt_t sack;
+  const slot_ack_pkt_t *v;
+  uint16_t len;
+
+  len = proto_build_slot_ack(&sack, 2, 3, 150, 1000, 200);
+  v = proto_slot_ack_view(&sack, len);
+  CHECK(v != NULL && v->slot == 3 && v->wait_ms == 150 &&
+        v->period_ms == 1000 && v->len_ms == 200);
+  CHECK(proto_ack_view(&sack, len) != NULL);     /* a plain REQ_ACK too */
+  REJECTS(proto_slot_ack_view, sack, len, PKT_ACK);
+
+  /* grants no slot can be kept to */
+  proto_build_slot_ack(&sack, 2, 3, 150, 0, 200);
+  CHECK(proto_slot_ack_view(&sack, len) == NULL);
+  proto_build_slot_ack(&sack, 2, 3, 150, 100, 200);
+  CHECK(proto_slot_ack_view(&sack, len) == NULL);
+  proto_build_slot_ack(&sack, 2, 3, 150, 1000,
+                       PROTO_SLOT_BURST_MS + PROTO_SLOT_GUARD_MS);
+  CHECK(proto_slot_ack_view(&sack, len) == NULL);
+}
+
+static void test_disc(void)
+{
+  disc_pkt_t disc;
+  const disc_pkt_t *v;
+  uint16_t len;
+
+  len = proto_build_disc(&disc, 5, 17, PROTO_DISC_ACK, -63, 120);
+  v = proto_disc_view(&disc, len);
+  CHECK(v != NULL && v->src_id == 5 && v->seq == 17 &&
+        v->flags == PROTO_DISC_ACK && v->rssi == -63 && v->wait_ms == 120);
+  CHECK(proto_req_view(&disc, len) == NULL);     /* not a plain beacon */
+  REJECTS(proto_disc_view, disc, len, PKT_REQUEST);
+}
+
+static void test_data(void)
+{
+  data_pkt_t data;
+  data_ts_pkt_t ts;
+  int16_t l[PROTO_CHUNK_SIZE], m[PROTO_CHUNK_SIZE];
+  uint16_t len;
+
+  len = proto_build_data(&data, 1, 2, light, motion);
+  CHECK(proto_data_view(&data, len)->seq == 2);
+  proto_data_unpack(&data, l, m);
+  CHECK(memcmp(l, light, sizeof(l)) == 0 && memcmp(m, motion, sizeof(m)) == 0);
+  REJECTS(proto_data_view, data, len, PKT_DATA_TS);
+
+  len = proto_build_data_ts(&ts, 1, 0, light, motion, t_off, t_off[0]);
+  CHECK(proto_data_ts_view(&ts, len) != NULL);
+  CHECK(ts.dt[0] == 0 && ts.dt[1] == t_off[1] - t_off[0]);
+  CHECK(ts.dt[PROTO_CHUNK_SIZE - 1] == 0xFF);    /* saturated gap */
+  proto_data_unpack((const data_pkt_t *)&ts, l, m);
+  CHECK(memcmp(l, light, sizeof(l)) == 0 && memcmp(m, motion, sizeof(m)) == 0);
+  REJECTS(proto_data_ts_view, ts, len, PKT_DATA);
+}
+
+static void test_run_parity(void)
+{
+  run_pkt_t run[3], par;
+  int16_t l[PROTO_RUN_MAX], m[PROTO_RUN_MAX];
+  uint8_t dt[PROTO_RUN_MAX];
+  uint16_t len, plen;
+
+  len = proto_build_run(&run[0], 1, 15, 5, light, motion, NULL, 0);
+  CHECK(len == PROTO_RUN_HDR_LEN + 5 * sizeof(run_rec_t));
+  CHECK(run_view(&run[0], len) != NULL && n == 5 && run[0].off == 15);
+  proto_run_unpack(&run[0], n, l, m, dt);
+  CHECK(memcmp(l, light, 5 * sizeof(*l)) == 0 && dt[4] == 0);
+  CHECK(run_view(&run[0], PROTO_RUN_HDR_LEN) == NULL);   /* no records */
+  REJECTS(run_view, run[0], len, PKT_DATA);
+
+  len = proto_build_run(&run[0], 1, 0, 10, light, motion, t_off, t_off[0]);
+  CHECK(proto_type(&run[0], len) == PKT_RUN_TS);
+  CHECK(run_view(&run[0], len) != NULL && n == 10);
+  proto_run_unpack(&run[0], n, l, m, dt);
+  CHECK(memcmp(m, motion, 10 * sizeof(*m)) == 0 &&
+        dt[3] == t_off[3] - t_off[2]);
+  REJECTS(run_view, run[0], len, PKT_DATA_TS);
+
+  /* XOR of runs 0 and 2 rebuilds run 2 from run 0 */
+  proto_build_run(&run[1], 1, 5, 5, &light[5], &motion[5], NULL, 0);
+  len = proto_build_run(&run[2], 1, 10, 5, &light[10], &motion[10], NULL, 0);
+  plen = proto_build_parity(&par, 1, PROTO_PARITY_GROUP(0, 2), 5, 0);
+  CHECK(plen == len);
+  proto_parity_add(&par, &run[0], len);
+  proto_parity_add(&par, &run[2], len);
+  CHECK(run_view(&par, plen) != NULL && n == 5);
+  CHECK(PROTO_PARITY_FIRST(par.off) == 0 && PROTO_PARITY_STRIDE(par.off) == 2);
+  proto_parity_add(&par, &run[0], len);
+  CHECK(memcmp(par.rec, run[2].rec, 5 * sizeof(run_rec_t)) == 0);
+  REJECTS(run_view, par, plen, PKT_ALERT);
+}
+
+static void test_block_ack(void)
+{
+  block_ack_pkt_t back;
+  uint16_t len;
+
+  len = proto_build_block_ack(&back, 2, 0x0FFF, 9);
+  CHECK(proto_block_ack_view(&back, len)->map == 0x0FFF && back.heard == 9);
+  REJECTS(proto_block_ack_view, back, len, PKT_ACK);
+}
+
+static void test_alert(void)
+{
+  alert_pkt_t alert;
+  uint16_t len;
+
+  len = proto_build_alert(&alert, 1, 4, -350);
+  CHECK(proto_alert_view(&alert, len)->motion == -350 && alert.seq == 4);
+  REJECTS(proto_alert_view, alert, len, PKT_ALERT_ACK);
+}
+
+static void test_summary(void)
+{
+  summary_pkt_t sum;
+  feat_summary_t fl, fm;
+  const summary_pkt_t *v;
+  uint16_t len;
+
+  memset(&fl, 0x11, sizeof(fl));
+  memset(&fm, 0x22, sizeof(fm));
+  len = proto_build_summary(&sum, 1, 3, 60, 590, &fl, &fm);
+  v = proto_summary_view(&sum, len);
+  CHECK(v != NULL && v->n == 60 && v->span == 590 &&
+        memcmp(&v->light, &fl, sizeof(fl)) == 0 &&
+        memcmp(&v->motion, &fm, sizeof(fm)) == 0);
+  REJECTS(proto_summary_view, sum, len, PKT_DATA);
+}
+
+static void test_relay(void)
+{
+  relay_pkt_t relay;
+  uint8_t dt[PROTO_RELAY_RUN];
+  const relay_pkt_t *v;
+  uint16_t len;
+
+  for(uint8_t i = 0; i < PROTO_RELAY_RUN; i++) dt[i] = i;
+  len = proto_build_relay(&relay, 3, 7, 2 | PROTO_RELAY_LAST, 1, 2, 9, 45,
+                          PROTO_RELAY_RUN, light, motion, dt);
+  v = relay_view(&relay, len);
+  CHECK(v != NULL && n == PROTO_RELAY_RUN && v->batch == 7 &&
+        PROTO_RELAY_IDX(v->idx) == 2 && (v->idx & PROTO_RELAY_LAST) &&
+        v->origin == 1 && v->collector == 2 && v->set_no == 9 &&
+        v->off == 45);
+  CHECK(v->rec[14].light == light[14] && v->rec[14].dt == 14);
+  REJECTS(relay_view, relay, len, PKT_RUN_TS);
+}
+
+static void test_mgmt(void)
+{
+  query_pkt_t q;
+  reply_pkt_t r;
+  const query_pkt_t *qv;
+  uint16_t len;
+
+  len = proto_build_query(&q, 9, 1, QUERY_HOURLY, QUERY_ANY, 7200, 10);
+  qv = proto_query_view(&q, len);
+  CHECK(qv != NULL && qv->kind == QUERY_HOURLY && qv->sender == QUERY_ANY &&
+        qv->span == 7200 && qv->skip == 10);
+  CHECK(proto_type(&q, len) == 0);               /* not a data‑path frame */
+  REJECTS(proto_query_view, q, len, MGMT_REPLY);
+
+  memset(&r, 0, sizeof(r));
+  r.set[1].seq = 77;
+  len = proto_build_reply(&r, 2, 1, QUERY_SETS, QUERY_LAST, 4, 2);
+  CHECK(reply_view(&r, len) != NULL && n == 2 && r.first == 4 &&
+        r.set[1].seq == 77 && (r.flags & QUERY_LAST));
+  REJECTS(reply_view, r, len, MGMT_QUERY);
+
+  len = proto_build_reply(&r, 2, 1, QUERY_HOURLY, 0, 0, PROTO_REPLY_HOURS);
+  CHECK(reply_view(&r, len) != NULL && n == PROTO_REPLY_HOURS);
+  r.kind = 0;
+  CHECK(reply_view(&r, len) == NULL);            /* unknown kind */
+}
+
+int main(void)
+{
+  for(uint8_t i = 0; i < PROTO_CHUNK_SIZE; i++) {
+    light[i]  = (int16_t)(1000 + 37 * i);
+    motion[i] = (int16_t)(-50 + 11 * i);
+    t_off[i]  = (uint16_t)(65500 + 10 * i);      /* wraps at 2^16 */
+  }
+  t_off[PROTO_CHUNK_SIZE - 1] += 1000;           /* gap > 0xFF ticks */
+
+  test_req_ack();
+  test_slot_ack();
+  test_disc();
+  test_data();
+  test_run_parity();
+  test_block_ack();
+  test_alert();
+  test_summary();
+  test_relay();
+  test_mgmt();
+
+  printf("%u checks, %u failed\n", checks, failed);
+  return failed != 0;
+}